@@ -28,6 +28,12 @@
 #include <array>
 #include <mutex>
 #include <thread>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
 
 // a recursive mutex that can identify it's owner thread
 // see: http://stackoverflow.com/questions/21892934/how-to-assert-if-a-stdmutex-is-lockedclass
@@ -118,6 +124,8 @@ template <typename T, const std::size_t numThreads>
 class RealtimeConcurrent
 {
 public:
+    static constexpr std::size_t numCopies = numThreads+1;
+    
     RealtimeConcurrent() noexcept {}
     RealtimeConcurrent(const T& resource)
     {
@@ -232,6 +240,31 @@ public:
         return allCopiesUpdated;
     }
     
+    /** call apply(copy, copyIndex) on each of the copies that no other thread has locked, returns false if any of them were skipped */
+    template <typename Function>
+    bool tryToApply(Function&& apply)
+    {
+        bool allCopiesApplied = true;
+        T* copyToApply = nullptr;
+        for (std::size_t i = 0; i < copies.size(); ++i) {
+            const std::unique_lock<Mutex> copyLocked (copies[i].get(copyToApply), std::try_to_lock);
+            if (copyLocked)
+                apply(*copyToApply, i);
+            else
+                allCopiesApplied = false;
+        }
+        return allCopiesApplied;
+    }
+    
+    /** the index (as given to tryToApply()) of a copy from get() */
+    std::size_t indexOf(const T* copy) const noexcept
+    {
+        for (std::size_t i = 0; i < copies.size(); ++i)
+            if (copies[i].isSame(copy))
+                return i;
+        return copies.size();
+    }
+    
     void update(const T* updatedCopy)
     {
         // "spin" update, potentially most productive strategy if we can't get all copies updated in one thread epoch
@@ -281,11 +314,118 @@ private:
         }
         bool upToDate = true;
     };
-    std::array<UpdateableCopiableLockable, numThreads+1> copies; // N+1 copies for N threads b/c if one thread is in the middle of an update, up to two copies may be locked and we still want at least N-1 free copies for the other N-1 threads to be able to have immediate access to if need be
+    std::array<UpdateableCopiableLockable, numCopies> copies; // N+1 copies for N threads b/c if one thread is in the middle of an update, up to two copies may be locked and we still want at least N-1 free copies for the other N-1 threads to be able to have immediate access to if need be
     std::mutex updateLock; // updates must be serialized because during an update we can have up to two copies locked at once.  if each thread can potentially be updating at once, we'd need more copies and how would those simultaneous updates work anyways?
     mutable Mutex dummyLock; // lock that is returned if get() should fail to produce an immediately lockable copy of the resource
 };
 
+// immutable versions of a resource that the threads editing it publish for realtime threads to read, which always get the latest version without locking, copying or allocating anything.
+// a version replaced by a newer one is retired, and freed by a publishing thread once no reader that could have gotten it is still reading it (epoch based reclamation),
+// so long as numReaders >= the actual number of threads that are simultaneously reading the resource with read().
+// one more slot is reserved for readReserved(), so the thread that can least afford to miss a snapshot (the audio thread) always gets one
+template <typename T, const std::size_t numReaders>
+class SnapshotPublisher
+{
+public:
+    struct Snapshot
+    {
+        Snapshot(const T& theResource, const std::uint64_t theVersion) : resource(theResource), version(theVersion) {}
+        const T resource;
+        const std::uint64_t version; // counts up from 1 with each publish()
+    };
+    
+    // the latest snapshot when read() was called, which is not freed until this goes out of scope
+    class Reader
+    {
+    public:
+        Reader(Reader&& other) noexcept : snapshot(other.snapshot), readerEpoch(other.readerEpoch) { other.readerEpoch = nullptr; }
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+        ~Reader() { if (readerEpoch) readerEpoch->store(notReading); }
+        explicit operator bool() const noexcept { return snapshot != nullptr; }
+        const T& operator*() const noexcept { return snapshot->resource; }
+        const T* operator->() const noexcept { return &snapshot->resource; }
+        std::uint64_t getVersion() const noexcept { return snapshot ? snapshot->version : 0; }
+    private:
+        friend class SnapshotPublisher;
+        Reader(const Snapshot* theSnapshot, std::atomic<std::uint64_t>* theReaderEpoch) noexcept : snapshot(theSnapshot), readerEpoch(theReaderEpoch) {}
+        const Snapshot* snapshot;
+        std::atomic<std::uint64_t>* readerEpoch;
+    };
+    
+    ~SnapshotPublisher()
+    {
+        delete latest.load();
+    }
+    
+    /** get the latest snapshot, for the realtime threads */
+    Reader read() const noexcept
+    {
+        // the reader takes a slot with the epoch it starts reading in before it gets the latest snapshot, so that every snapshot it could get is retired in a later epoch and kept for it
+        const std::uint64_t currentEpoch = epoch.load();
+        for (auto& e : readerEpochs) {
+            std::uint64_t expected = notReading;
+            if (e.compare_exchange_strong(expected, currentEpoch))
+                return {latest.load(), &e};
+        }
+        // should never get here if numReaders >= the number of threads reading at once
+        return {nullptr, nullptr};
+    }
+    
+    /** get the latest snapshot through the reserved slot, which never fails, for the one realtime thread that uses it (one read at a time) */
+    Reader readReserved() const noexcept
+    {
+        reservedReaderEpoch.store(epoch.load());
+        return {latest.load(), &reservedReaderEpoch};
+    }
+    
+    /** publish a copy of the resource as the latest snapshot, and free the retired ones that are no longer read */
+    void publish(const T& resource)
+    {
+        const std::lock_guard<std::mutex> lock (publishLock);
+        std::unique_ptr<const Snapshot> replaced (latest.exchange(new Snapshot(resource, ++version)));
+        // a reader can only have gotten the replaced snapshot if it started reading before the epoch that begins now
+        const std::uint64_t retiredEpoch = ++epoch;
+        if (replaced)
+            retired.push_back({std::move(replaced), retiredEpoch});
+        freeRetired();
+    }
+    
+    /** free the retired snapshots that are no longer read, which publish() also does */
+    void reclaim()
+    {
+        const std::lock_guard<std::mutex> lock (publishLock);
+        freeRetired();
+    }
+    
+private:
+    void freeRetired()
+    {
+        const std::uint64_t reservedEpoch = reservedReaderEpoch.load();
+        std::uint64_t oldestReaderEpoch = reservedEpoch != notReading ? reservedEpoch : std::numeric_limits<std::uint64_t>::max();
+        for (const auto& e : readerEpochs) {
+            const std::uint64_t readerEpoch = e.load();
+            if (readerEpoch != notReading)
+                oldestReaderEpoch = std::min(oldestReaderEpoch, readerEpoch);
+        }
+        retired.erase(std::remove_if(retired.begin(), retired.end(), [oldestReaderEpoch] (const Retired& r) { return r.epoch <= oldestReaderEpoch; }),
+                      retired.end());
+    }
+    static constexpr std::uint64_t notReading = 0;
+    struct Retired
+    {
+        std::unique_ptr<const Snapshot> snapshot;
+        std::uint64_t epoch; // the epoch that began when the snapshot was replaced
+    };
+    std::atomic<const Snapshot*> latest {nullptr};
+    std::atomic<std::uint64_t> epoch {1};
+    mutable std::array<std::atomic<std::uint64_t>, numReaders> readerEpochs {}; // the epoch each reader started reading in, or notReading
+    mutable std::atomic<std::uint64_t> reservedReaderEpoch {notReading}; // the same for readReserved()
+    std::vector<Retired> retired; // the replaced snapshots that may still be read
+    std::uint64_t version = 0;
+    std::mutex publishLock; // publishing is serialized so the versions and retired epochs go up in the order the snapshots are published
+};
+
 /* example code:
  // the data that needs to be shared between numThreads threads
  ConcurrentResource<Thing, numThreads> c_resource;
@@ -0,0 +1,329 @@
+//
+//  ConvolutionKernels.cpp
+//  ThreeDAudio
+//
+//
+/*
+     3DAudio: simulates surround sound audio for headphones
+     Copyright (C) 2016  Andrew Barker
+
+     This program is free software: you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation, either version 3 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+     The author can be contacted via email at andrew.barker.12345@gmail.com.
+ */
+
+#include "ConvolutionKernels.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+  #define CONVOLUTION_KERNELS_X86
+  #include <immintrin.h>
+  #ifdef _MSC_VER
+    #include <intrin.h>
+    #define TARGET_AVX2
+  #else // gcc/clang only let avx2 intrinsics be used in functions compiled for avx2
+    #define TARGET_AVX2 __attribute__((target("avx2,fma")))
+  #endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+  #define CONVOLUTION_KERNELS_NEON
+  #include <arm_neon.h>
+#endif
+#define TARGET_NONE
+
+// the kernels work on contiguous windows of input, the window for output n starts at x[n]
+typedef void (*StaticKernel)(const float* x, const float* h, int Nh, const float* hScales,
+                             float* outputL, float* outputR, int N);
+// the blended kernel computes outputs nBegin to nEnd-1 of an N sample buffer
+typedef void (*BlendedKernel)(const float* x, const float* hs, int Nh, int numHs, const float* hScales,
+                              float* outputL, float* outputR, int nBegin, int nEnd, int N);
+
+// stamps out the kernels for an instruction set given its dot product functions
+#define CONVOLUTION_KERNELS(ISA, TARGET) \
+TARGET static void convolveStatic##ISA(const float* x, const float* h, const int Nh, const float* hScales, \
+                                       float* outputL, float* outputR, const int N) \
+{ \
+    for (int n = 0; n < N; ++n) { \
+        float sumL, sumR; \
+        dotStereo##ISA(&x[n], h, Nh, sumL, sumR); \
+        outputL[n] = sumL * hScales[0]; \
+        outputR[n] = sumR * hScales[1]; \
+    } \
+} \
+TARGET static void convolveBlended##ISA(const float* x, const float* hs, const int Nh, const int numHs, const float* hScales, \
+                                        float* outputL, float* outputR, const int nBegin, const int nEnd, const int N) \
+{ \
+    const float L = N / float(numHs - 1); \
+    for (int n = nBegin; n < nEnd; ++n) { \
+        const float ndL = n / L; \
+        const int hi = ndL; \
+        float sum1L, sum1R, sum2L, sum2R; \
+        dot4##ISA(&x[n - nBegin], &hs[hi * 2 * Nh], &hs[(hi + 1) * 2 * Nh], Nh, sum1L, sum1R, sum2L, sum2R); \
+        const float hBlend = ndL - hi; \
+        outputL[n] = sum1L * hScales[2*hi  ] * (1-hBlend) + sum2L * hScales[2*(hi+1)  ] * hBlend; \
+        outputR[n] = sum1R * hScales[2*hi+1] * (1-hBlend) + sum2R * hScales[2*(hi+1)+1] * hBlend; \
+    } \
+}
+
+// in the dot products below, the interleaved hrir block holding taps j to j+interleavedBlockSize-1 starts at h[2*j] for the left ear and h[2*j+interleavedBlockSize] for the right ear
+
+#if !defined(CONVOLUTION_KERNELS_X86) && !defined(CONVOLUTION_KERNELS_NEON)
+/***** scalar, only for when there is no simd instruction set to pick *****/
+static inline void dotStereoScalar(const float* x, const float* h, const int Nh, float& sumL, float& sumR) noexcept
+{
+    sumL = sumR = 0;
+    for (int j = 0; j < Nh; j += interleavedBlockSize) {
+        for (int k = 0; k < interleavedBlockSize; ++k) {
+            sumL += x[j+k] * h[2*j + k];
+            sumR += x[j+k] * h[2*j + interleavedBlockSize + k];
+        }
+    }
+}
+
+static inline void dot4Scalar(const float* x, const float* h1, const float* h2, const int Nh,
+                              float& sum1L, float& sum1R, float& sum2L, float& sum2R) noexcept
+{
+    sum1L = sum1R = sum2L = sum2R = 0;
+    for (int j = 0; j < Nh; j += interleavedBlockSize) {
+        for (int k = 0; k < interleavedBlockSize; ++k) {
+            sum1L += x[j+k] * h1[2*j + k];
+            sum1R += x[j+k] * h1[2*j + interleavedBlockSize + k];
+            sum2L += x[j+k] * h2[2*j + k];
+            sum2R += x[j+k] * h2[2*j + interleavedBlockSize + k];
+        }
+    }
+}
+
+CONVOLUTION_KERNELS(Scalar, TARGET_NONE)
+#endif // scalar
+
+#ifdef CONVOLUTION_KERNELS_X86
+/***** SSE *****/
+static inline float horizontalSum(const __m128 v) noexcept
+{
+    const __m128 s = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    return _mm_cvtss_f32(_mm_add_ss(s, _mm_shuffle_ps(s, s, 1)));
+}
+
+// multiply accumulate one interleaved block (two vectors per ear)
+static inline void macBlockSSE(const __m128 x0, const __m128 x1, const float* h, __m128& sumL, __m128& sumR) noexcept
+{
+    sumL = _mm_add_ps(sumL, _mm_add_ps(_mm_mul_ps(x0, _mm_loadu_ps(&h[ 0])), _mm_mul_ps(x1, _mm_loadu_ps(&h[ 4]))));
+    sumR = _mm_add_ps(sumR, _mm_add_ps(_mm_mul_ps(x0, _mm_loadu_ps(&h[ 8])), _mm_mul_ps(x1, _mm_loadu_ps(&h[12]))));
+}
+
+static inline void dotStereoSSE(const float* x, const float* h, const int Nh, float& sumL, float& sumR) noexcept
+{
+    __m128 sL = _mm_setzero_ps();
+    __m128 sR = _mm_setzero_ps();
+    for (int j = 0; j < Nh; j += interleavedBlockSize)
+        macBlockSSE(_mm_loadu_ps(&x[j]), _mm_loadu_ps(&x[j+4]), &h[2*j], sL, sR);
+    sumL = horizontalSum(sL);
+    sumR = horizontalSum(sR);
+}
+
+static inline void dot4SSE(const float* x, const float* h1, const float* h2, const int Nh,
+                           float& sum1L, float& sum1R, float& sum2L, float& sum2R) noexcept
+{
+    __m128 s1L = _mm_setzero_ps(), s1R = _mm_setzero_ps();
+    __m128 s2L = _mm_setzero_ps(), s2R = _mm_setzero_ps();
+    for (int j = 0; j < Nh; j += interleavedBlockSize) {
+        const __m128 x0 = _mm_loadu_ps(&x[j]);
+        const __m128 x1 = _mm_loadu_ps(&x[j+4]);
+        macBlockSSE(x0, x1, &h1[2*j], s1L, s1R);
+        macBlockSSE(x0, x1, &h2[2*j], s2L, s2R);
+    }
+    sum1L = horizontalSum(s1L);
+    sum1R = horizontalSum(s1R);
+    sum2L = horizontalSum(s2L);
+    sum2R = horizontalSum(s2R);
+}
+
+CONVOLUTION_KERNELS(SSE, TARGET_NONE)
+
+/***** AVX2 + FMA *****/
+TARGET_AVX2 static inline float horizontalSum(const __m256 v) noexcept
+{
+    return horizontalSum(_mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1)));
+}
+
+TARGET_AVX2 static inline void dotStereoAVX2(const float* x, const float* h, const int Nh, float& sumL, float& sumR) noexcept
+{
+    __m256 sL = _mm256_setzero_ps();
+    __m256 sR = _mm256_setzero_ps();
+    for (int j = 0; j < Nh; j += interleavedBlockSize) {
+        const __m256 xj = _mm256_loadu_ps(&x[j]);
+        sL = _mm256_fmadd_ps(xj, _mm256_loadu_ps(&h[2*j    ]), sL);
+        sR = _mm256_fmadd_ps(xj, _mm256_loadu_ps(&h[2*j + 8]), sR);
+    }
+    sumL = horizontalSum(sL);
+    sumR = horizontalSum(sR);
+}
+
+TARGET_AVX2 static inline void dot4AVX2(const float* x, const float* h1, const float* h2, const int Nh,
+                                        float& sum1L, float& sum1R, float& sum2L, float& sum2R) noexcept
+{
+    __m256 s1L = _mm256_setzero_ps(), s1R = _mm256_setzero_ps();
+    __m256 s2L = _mm256_setzero_ps(), s2R = _mm256_setzero_ps();
+    for (int j = 0; j < Nh; j += interleavedBlockSize) {
+        const __m256 xj = _mm256_loadu_ps(&x[j]);
+        s1L = _mm256_fmadd_ps(xj, _mm256_loadu_ps(&h1[2*j    ]), s1L);
+        s1R = _mm256_fmadd_ps(xj, _mm256_loadu_ps(&h1[2*j + 8]), s1R);
+        s2L = _mm256_fmadd_ps(xj, _mm256_loadu_ps(&h2[2*j    ]), s2L);
+        s2R = _mm256_fmadd_ps(xj, _mm256_loadu_ps(&h2[2*j + 8]), s2R);
+    }
+    sum1L = horizontalSum(s1L);
+    sum1R = horizontalSum(s1R);
+    sum2L = horizontalSum(s2L);
+    sum2R = horizontalSum(s2R);
+}
+
+CONVOLUTION_KERNELS(AVX2, TARGET_AVX2)
+
+static bool cpuSupportsAVX2() noexcept
+{
+  #ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+    // fma and the os saving the ymm registers
+    __cpuid(info, 1);
+    if ((info[2] & (1 << 12)) == 0 || (info[2] & (1 << 27)) == 0 || (_xgetbv(0) & 6) != 6)
+        return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+  #else
+    __builtin_cpu_init(); // needed since this runs during static initialization
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+  #endif
+}
+#endif // CONVOLUTION_KERNELS_X86
+
+#ifdef CONVOLUTION_KERNELS_NEON
+/***** NEON *****/
+static inline float horizontalSum(const float32x4_t v) noexcept
+{
+  #if defined(__aarch64__) || defined(_M_ARM64)
+    return vaddvq_f32(v);
+  #else
+    const float32x2_t s = vadd_f32(vget_low_f32(v), vget_high_f32(v));
+    return vget_lane_f32(vpadd_f32(s, s), 0);
+  #endif
+}
+
+// multiply accumulate one interleaved block (two vectors per ear)
+static inline void macBlockNEON(const float32x4_t x0, const float32x4_t x1, const float* h, float32x4_t& sumL, float32x4_t& sumR) noexcept
+{
+    sumL = vmlaq_f32(vmlaq_f32(sumL, x0, vld1q_f32(&h[ 0])), x1, vld1q_f32(&h[ 4]));
+    sumR = vmlaq_f32(vmlaq_f32(sumR, x0, vld1q_f32(&h[ 8])), x1, vld1q_f32(&h[12]));
+}
+
+static inline void dotStereoNEON(const float* x, const float* h, const int Nh, float& sumL, float& sumR) noexcept
+{
+    float32x4_t sL = vdupq_n_f32(0);
+    float32x4_t sR = vdupq_n_f32(0);
+    for (int j = 0; j < Nh; j += interleavedBlockSize)
+        macBlockNEON(vld1q_f32(&x[j]), vld1q_f32(&x[j+4]), &h[2*j], sL, sR);
+    sumL = horizontalSum(sL);
+    sumR = horizontalSum(sR);
+}
+
+static inline void dot4NEON(const float* x, const float* h1, const float* h2, const int Nh,
+                            float& sum1L, float& sum1R, float& sum2L, float& sum2R) noexcept
+{
+    float32x4_t s1L = vdupq_n_f32(0), s1R = vdupq_n_f32(0);
+    float32x4_t s2L = vdupq_n_f32(0), s2R = vdupq_n_f32(0);
+    for (int j = 0; j < Nh; j += interleavedBlockSize) {
+        const float32x4_t x0 = vld1q_f32(&x[j]);
+        const float32x4_t x1 = vld1q_f32(&x[j+4]);
+        macBlockNEON(x0, x1, &h1[2*j], s1L, s1R);
+        macBlockNEON(x0, x1, &h2[2*j], s2L, s2R);
+    }
+    sum1L = horizontalSum(s1L);
+    sum1R = horizontalSum(s1R);
+    sum2L = horizontalSum(s2L);
+    sum2R = horizontalSum(s2R);
+}
+
+CONVOLUTION_KERNELS(NEON, TARGET_NONE)
+#endif // CONVOLUTION_KERNELS_NEON
+
+/***** dispatch *****/
+struct Kernels
+{
+    const char* name;
+    StaticKernel convolveStatic;
+    BlendedKernel convolveBlended;
+};
+
+static Kernels selectKernels() noexcept
+{
+  #if defined(CONVOLUTION_KERNELS_X86)
+    if (cpuSupportsAVX2())
+        return {"AVX2", convolveStaticAVX2, convolveBlendedAVX2};
+    return {"SSE", convolveStaticSSE, convolveBlendedSSE};
+  #elif defined(CONVOLUTION_KERNELS_NEON)
+    return {"NEON", convolveStaticNEON, convolveBlendedNEON};
+  #else
+    return {"Scalar", convolveStaticScalar, convolveBlendedScalar};
+  #endif
+}
+
+// picked once when the plugin is loaded, so the audio thread never has to
+static const Kernels kernels = selectKernels();
+
+const char* getConvolutionKernelsName() noexcept
+{
+    return kernels.name;
+}
+
+void interleaveHRIRs(const float* hs, const int Nh, const int numHs, float* hsInterleaved) noexcept
+{
+    assert(Nh % interleavedBlockSize == 0);
+    for (int i = 0; i < numHs; ++i) {
+        const float* hL = &hs[ i*2   *Nh];
+        const float* hR = &hs[(i*2+1)*Nh];
+        float* h = &hsInterleaved[i*2*Nh];
+        for (int j = 0; j < Nh; j += interleavedBlockSize) {
+            for (int k = 0; k < interleavedBlockSize; ++k) {
+                h[2*j + k]                        = hL[Nh-1 - (j+k)];
+                h[2*j + interleavedBlockSize + k] = hR[Nh-1 - (j+k)];
+            }
+        }
+    }
+}
+
+void convolveMirrored(const float* cBuf, const int cBufIdx, const int cBufN,
+                      const float* hInterleaved, const int Nh, const float* hScales,
+                      float* outputL, float* outputR, const int N) noexcept
+{
+    // the window for output n is the Nh samples ending at cBufIdx+n, which is contiguous when taken from the mirrored copy,
+    // and consecutive outputs' windows are one sample apart until cBufIdx+n wraps around the circular buffer
+    const int N1 = std::min(N, cBufN - cBufIdx);
+    kernels.convolveStatic(&cBuf[cBufIdx + cBufN - (Nh - 1)], hInterleaved, Nh, hScales, outputL, outputR, N1);
+    if (N1 < N)
+        kernels.convolveStatic(&cBuf[cBufN - (Nh - 1)], hInterleaved, Nh, hScales, &outputL[N1], &outputR[N1], N - N1);
+}
+
+void convolveMirrored(const float* cBuf, const int cBufIdx, const int cBufN,
+                      const float* hsInterleaved, const int Nh, const int numHs, const float* hScales,
+                      float* outputL, float* outputR, const int N) noexcept
+{
+    const int N1 = std::min(N, cBufN - cBufIdx);
+    kernels.convolveBlended(&cBuf[cBufIdx + cBufN - (Nh - 1)], hsInterleaved, Nh, numHs, hScales, outputL, outputR, 0, N1, N);
+    if (N1 < N)
+        kernels.convolveBlended(&cBuf[cBufN - (Nh - 1)], hsInterleaved, Nh, numHs, hScales, outputL, outputR, N1, N, N);
+}
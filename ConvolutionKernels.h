@@ -0,0 +1,53 @@
+//
+//  ConvolutionKernels.h
+//  ThreeDAudio
+//
+//
+/*
+     3DAudio: simulates surround sound audio for headphones
+     Copyright (C) 2016  Andrew Barker
+
+     This program is free software: you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation, either version 3 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+     The author can be contacted via email at andrew.barker.12345@gmail.com.
+ */
+
+#ifndef ConvolutionKernels_h
+#define ConvolutionKernels_h
+
+// SIMD versions of the circular buffer convolve()s in Functions.h, the instruction set (SSE, AVX2 + FMA, NEON) is picked at runtime from what the cpu supports.
+// instead of walking the circular buffer backwards, they expect a mirrored circular buffer (cBufN samples written twice, at i and i + cBufN) so every output's window of input is contiguous,
+// and time reversed hrirs so each output sample is a plain dot product of the window and the hrir.
+// both ears are computed together from each load of the input, so the left and right hrirs are interleaved in blocks of interleavedBlockSize taps.
+
+// number of consecutive taps of one ear's hrir before switching to the other ear's, hrir lengths must be a multiple of it
+static constexpr int interleavedBlockSize = 8;
+
+// name of the instruction set being used
+const char* getConvolutionKernelsName() noexcept;
+
+// time reverse and interleave numHs left/right hrir pairs (each pair being Nh left samples followed by Nh right samples)
+void interleaveHRIRs(const float* hs, int Nh, int numHs, float* hsInterleaved) noexcept;
+
+// same as the static hrir convolve() for both ears, but with the mirrored circular buffer cBuf (2*cBufN samples, cBufN >= Nh) and an interleaved hrir pair
+void convolveMirrored(const float* cBuf, int cBufIdx, int cBufN,
+                      const float* hInterleaved, int Nh, const float* hScales,
+                      float* outputL, float* outputR, int N) noexcept;
+
+// same as the blended hrirs convolve() for both ears, but with the mirrored circular buffer cBuf (2*cBufN samples, cBufN >= Nh) and interleaved hrir pairs
+void convolveMirrored(const float* cBuf, int cBufIdx, int cBufN,
+                      const float* hsInterleaved, int Nh, int numHs, const float* hScales,
+                      float* outputL, float* outputR, int N) noexcept;
+
+#endif /* ConvolutionKernels_h */
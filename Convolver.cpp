@@ -0,0 +1,239 @@
+//
+//  Convolver.cpp
+//  ThreeDAudio
+//
+//
+/*
+     3DAudio: simulates surround sound audio for headphones
+     Copyright (C) 2016  Andrew Barker
+
+     This program is free software: you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation, either version 3 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+     The author can be contacted via email at andrew.barker.12345@gmail.com.
+ */
+
+#include "Convolver.h"
+#include <cmath>
+#include <algorithm>
+
+// multiply accumulate that skips the inf/nan handling of std::complex's operator*
+static inline void complexMultiplyAdd(const Complex* a, const Complex* b, Complex* sum, const int N) noexcept
+{
+    for (int n = 0; n < N; ++n)
+        sum[n] = Complex(sum[n].real() + a[n].real() * b[n].real() - a[n].imag() * b[n].imag(),
+                         sum[n].imag() + a[n].real() * b[n].imag() + a[n].imag() * b[n].real());
+}
+
+/***** FFT *****/
+void FFT::prepare(const int newSize)
+{
+    size = newSize;
+    const int n = size / 2;
+    twiddles.resize(n / 2);
+    for (int k = 0; k < n / 2; ++k)
+        twiddles[k] = std::polar(1.0f, float(-2.0 * M_PI * k / n));
+    realTwiddles.resize(n + 1);
+    for (int k = 0; k <= n; ++k)
+        realTwiddles[k] = std::polar(1.0f, float(-2.0 * M_PI * k / size));
+    bitReverse.resize(n);
+    int numBits = 0;
+    while ((1 << numBits) < n)
+        ++numBits;
+    for (int i = 0; i < n; ++i) {
+        int reversed = 0;
+        for (int b = 0; b < numBits; ++b)
+            if (i & (1 << b))
+                reversed |= 1 << (numBits - 1 - b);
+        bitReverse[i] = reversed;
+    }
+    work.resize(n);
+}
+
+void FFT::transform(Complex* data) noexcept
+{
+    const int n = size / 2;
+    for (int i = 0; i < n; ++i)
+        if (i < bitReverse[i])
+            std::swap(data[i], data[bitReverse[i]]);
+    for (int length = 2; length <= n; length <<= 1) {
+        const int halfLength = length >> 1;
+        const int step = n / length;
+        for (int i = 0; i < n; i += length) {
+            for (int k = 0; k < halfLength; ++k) {
+                const Complex w = twiddles[k * step];
+                const Complex u = data[i + k];
+                const Complex x = data[i + k + halfLength];
+                const Complex v (x.real() * w.real() - x.imag() * w.imag(),
+                                 x.real() * w.imag() + x.imag() * w.real());
+                data[i + k] = u + v;
+                data[i + k + halfLength] = u - v;
+            }
+        }
+    }
+}
+
+void FFT::forward(const float* input, Complex* output) noexcept
+{
+    const int n = size / 2;
+    // pack the even/odd samples into the real/imaginary parts of a half size complex transform
+    for (int k = 0; k < n; ++k)
+        work[k] = Complex(input[2*k], input[2*k+1]);
+    transform(&work[0]);
+    // then split the even/odd spectra back apart and merge them into the real signal's spectrum
+    output[0] = Complex(work[0].real() + work[0].imag(), 0);
+    output[n] = Complex(work[0].real() - work[0].imag(), 0);
+    for (int k = 1; k < n; ++k) {
+        const Complex z = work[k];
+        const Complex zc = std::conj(work[n-k]);
+        const Complex even = (z + zc) * 0.5f;
+        const Complex odd = (z - zc) * Complex(0, -0.5f);
+        const Complex w = realTwiddles[k];
+        output[k] = Complex(even.real() + w.real() * odd.real() - w.imag() * odd.imag(),
+                            even.imag() + w.real() * odd.imag() + w.imag() * odd.real());
+    }
+}
+
+void FFT::inverse(const Complex* input, float* output) noexcept
+{
+    const int n = size / 2;
+    // undo the split/merge of forward() and conjugate so the forward transform computes the inverse
+    for (int k = 0; k < n; ++k) {
+        const Complex x = input[k];
+        const Complex xc = std::conj(input[n-k]);
+        const Complex even = x + xc;
+        const Complex d = x - xc;
+        const Complex w = std::conj(realTwiddles[k]);
+        const Complex odd (d.real() * w.real() - d.imag() * w.imag(),
+                           d.real() * w.imag() + d.imag() * w.real());
+        work[k] = Complex(even.real() - odd.imag(), -(even.imag() + odd.real()));
+    }
+    transform(&work[0]);
+    for (int k = 0; k < n; ++k) {
+        output[2*k  ] =  work[k].real();
+        output[2*k+1] = -work[k].imag();
+    }
+}
+
+/***** ConvolverInput *****/
+void ConvolverInput::allocate(const int maxBufferSize, const int filterLength, const int newPartitionSize)
+{
+    partitionSize = newPartitionSize;
+    numPartitions = (filterLength + partitionSize - 1) / partitionSize;
+    fft.prepare(2 * partitionSize);
+    numBins = fft.getNumBins();
+    // a buffer can span one more block than it has full blocks worth of samples
+    const int maxNumSegments = (maxBufferSize + partitionSize - 1) / partitionSize + 1;
+    numSlots = numPartitions + maxNumSegments;
+    spectra.resize(numSlots * numBins);
+    segments.resize(maxNumSegments);
+    window.resize(2 * partitionSize);
+    reset();
+}
+
+void ConvolverInput::reset() noexcept
+{
+    for (auto& x : spectra)
+        x = 0;
+    currentSlot = 0;
+    blockOffset = 0;
+    numSegments = 0;
+}
+
+void ConvolverInput::transform(const float* cBuf, const int cBufIdx, const int cBufN, const int N) noexcept
+{
+    const int P = partitionSize;
+    numSegments = 0;
+    for (int pos = 0; pos < N; ) {
+        const int length = std::min(P - blockOffset, N - pos);
+        // the overlap-save window is the previous block followed by the current block, zero padded past the newest sample we have
+        int i = (cBufIdx + pos - blockOffset - P) % cBufN;
+        if (i < 0)
+            i += cBufN;
+        const int numValid = P + blockOffset + length;
+        for (int n = 0; n < numValid; ++n) {
+            window[n] = cBuf[i];
+            if (++i == cBufN)
+                i = 0;
+        }
+        for (int n = numValid; n < 2*P; ++n)
+            window[n] = 0;
+        fft.forward(&window[0], &spectra[currentSlot * numBins]);
+        segments[numSegments++] = {pos, length, blockOffset, currentSlot};
+        pos += length;
+        blockOffset += length;
+        if (blockOffset == P) {
+            blockOffset = 0;
+            currentSlot = (currentSlot + 1) % numSlots;
+        }
+    }
+}
+
+const Complex* ConvolverInput::getSpectrum(const Segment& segment, const int partition) const noexcept
+{
+    int slot = segment.slot - partition;
+    if (slot < 0)
+        slot += numSlots;
+    return &spectra[slot * numBins];
+}
+
+/***** PartitionedConvolver *****/
+void PartitionedConvolver::allocate(const int newFilterLength, const int newPartitionSize, const int numFilters)
+{
+    filterLength = newFilterLength;
+    partitionSize = newPartitionSize;
+    numPartitions = (filterLength + partitionSize - 1) / partitionSize;
+    fft.prepare(2 * partitionSize);
+    numBins = fft.getNumBins();
+    filterSpectra.resize(numFilters * numPartitions * numBins, 0);
+    accumulator.resize(numBins);
+    block.resize(2 * partitionSize);
+}
+
+void PartitionedConvolver::setFilter(const int filterIndex, const float* h) noexcept
+{
+    const int P = partitionSize;
+    // fold the normalization of the inverse fft into the filter's spectra
+    const float scale = 1.0f / (2 * P);
+    for (int k = 0; k < numPartitions; ++k) {
+        for (int n = 0; n < P; ++n) {
+            const int t = k * P + n;
+            block[n] = t < filterLength ? h[t] * scale : 0;
+            block[P + n] = 0;
+        }
+        fft.forward(&block[0], &filterSpectra[(filterIndex * numPartitions + k) * numBins]);
+    }
+}
+
+void PartitionedConvolver::copyFilter(const int fromFilterIndex, const int toFilterIndex) noexcept
+{
+    const int spectraSize = numPartitions * numBins;
+    std::copy_n(&filterSpectra[fromFilterIndex * spectraSize], spectraSize, &filterSpectra[toFilterIndex * spectraSize]);
+}
+
+void PartitionedConvolver::process(const ConvolverInput& input, const int filterIndex, float* output) noexcept
+{
+    const int P = partitionSize;
+    const Complex* H = &filterSpectra[filterIndex * numPartitions * numBins];
+    for (int s = 0; s < input.getNumSegments(); ++s) {
+        const auto& segment = input.getSegment(s);
+        for (auto& x : accumulator)
+            x = 0;
+        for (int k = 0; k < numPartitions; ++k)
+            complexMultiplyAdd(input.getSpectrum(segment, k), &H[k * numBins], &accumulator[0], numBins);
+        fft.inverse(&accumulator[0], &block[0]);
+        // the second half of the overlap-save window holds the valid output samples
+        for (int n = 0; n < segment.length; ++n)
+            output[segment.outputOffset + n] = block[P + segment.blockOffset + n];
+    }
+}
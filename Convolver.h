@@ -0,0 +1,129 @@
+//
+//  Convolver.h
+//  ThreeDAudio
+//
+//
+/*
+     3DAudio: simulates surround sound audio for headphones
+     Copyright (C) 2016  Andrew Barker
+
+     This program is free software: you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation, either version 3 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+     The author can be contacted via email at andrew.barker.12345@gmail.com.
+ */
+
+#ifndef Convolver_h
+#define Convolver_h
+
+#include <vector>
+#include <complex>
+
+// which algorithm the sources use to convolve their input with the hrirs
+enum class ConvolutionEngine { TIME_DOMAIN, PARTITIONED_FFT };
+
+// number of samples per partition for the uniformly partitioned fft convolution
+static constexpr int convolutionPartitionSize = 64;
+
+using Complex = std::complex<float>;
+
+// radix-2 fft of real valued signals
+class FFT
+{
+public:
+    /** precompute the twiddles and bit reversal table for a real transform of size samples (must be a power of 2) */
+    void prepare(int size);
+    /** transform size real samples into size/2+1 complex bins */
+    void forward(const float* input, Complex* output) noexcept;
+    /** transform size/2+1 complex bins back into size real samples, unnormalized so the output is scaled by size */
+    void inverse(const Complex* input, float* output) noexcept;
+    int getSize() const noexcept { return size; }
+    int getNumBins() const noexcept { return size/2 + 1; }
+private:
+    // in-place complex fft of size/2 points
+    void transform(Complex* data) noexcept;
+    int size = 0;
+    // twiddles for the half size complex transform
+    std::vector<Complex> twiddles;
+    // twiddles for splitting/merging the packed even/odd samples of the real signal
+    std::vector<Complex> realTwiddles;
+    std::vector<int> bitReverse;
+    std::vector<Complex> work;
+};
+
+// the overlap-save input spectra of a circular input buffer, one per partition sized block of input
+class ConvolverInput
+{
+public:
+    /** allocate enough spectra for the given maximum buffer size, filter length and partition size */
+    void allocate(int maxBufferSize, int filterLength, int partitionSize);
+    /** clear the input history */
+    void reset() noexcept;
+    /** transform the N samples starting at cBufIdx in the circular buffer (along with the history before them) into the spectra needed to convolve them, the buffer needs at least N+2*partitionSize samples of space */
+    void transform(const float* cBuf, int cBufIdx, int cBufN, int N) noexcept;
+    // a run of output samples that fall inside of one partition sized block
+    struct Segment
+    {
+        int outputOffset; // index of the first output sample of the segment
+        int length;       // number of output samples in the segment
+        int blockOffset;  // index of the first output sample within its block
+        int slot;         // index of the block's spectrum
+    };
+    int getNumSegments() const noexcept { return numSegments; }
+    const Segment& getSegment(int segment) const noexcept { return segments[segment]; }
+    /** spectrum of the block that is partition blocks before the segment's block */
+    const Complex* getSpectrum(const Segment& segment, int partition) const noexcept;
+    int getPartitionSize() const noexcept { return partitionSize; }
+    int getNumPartitions() const noexcept { return numPartitions; }
+    int getNumBins() const noexcept { return numBins; }
+private:
+    FFT fft;
+    int partitionSize = convolutionPartitionSize;
+    int numPartitions = 0;
+    int numBins = 0;
+    int numSlots = 0;
+    // spectra of the most recent input blocks, the current (possibly incomplete) block is zero padded and recomputed until it is complete
+    std::vector<Complex> spectra;
+    int currentSlot = 0;
+    // number of samples of the current block that have already been transformed
+    int blockOffset = 0;
+    std::vector<Segment> segments;
+    int numSegments = 0;
+    std::vector<float> window;
+};
+
+// uniformly partitioned overlap-save convolution of a ConvolverInput with a set of filters
+class PartitionedConvolver
+{
+public:
+    /** allocate space for numFilters filters of filterLength samples */
+    void allocate(int filterLength, int partitionSize, int numFilters);
+    /** compute the partitioned spectra of filter h (filterLength samples) */
+    void setFilter(int filterIndex, const float* h) noexcept;
+    /** copy the spectra of one filter to another */
+    void copyFilter(int fromFilterIndex, int toFilterIndex) noexcept;
+    /** convolve the input with a filter, outputing the samples for all of the input's segments */
+    void process(const ConvolverInput& input, int filterIndex, float* output) noexcept;
+private:
+    FFT fft;
+    int filterLength = 0;
+    int partitionSize = convolutionPartitionSize;
+    int numPartitions = 0;
+    int numBins = 0;
+    // numFilters * numPartitions spectra, prescaled to normalize the inverse fft
+    std::vector<Complex> filterSpectra;
+    std::vector<Complex> accumulator;
+    std::vector<float> block;
+};
+
+#endif /* Convolver_h */
@@ -26,11 +26,313 @@
  */
 
 #include "Doppler.h"
+#include "StackArray.h"
+#include <algorithm>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
 
-void Doppler::process(const float distance, const int bufferSize, const float* input, float* output) noexcept
+// allocates and frees the memory of every doppler effect in the process, so that the audio thread never has to.
+// the thread only runs while there are users (see DopplerBuffer::BackgroundThreadUser), the buffers stay registered in between.
+// the audio thread hands off work by setting an atomic flag, which the thread polls, so it never makes a system call or waits on a lock the thread holds
+class DopplerBufferThread
+{
+public:
+    static DopplerBufferThread& getInstance()
+    {
+        static DopplerBufferThread thread;
+        return thread;
+    }
+    void add(const std::shared_ptr<DopplerBuffer::Shared>& buffers)
+    {
+        const std::lock_guard<std::mutex> lock (mutex);
+        registered.push_back(buffers);
+    }
+    /** have the thread look for work at its next poll, realtime safe */
+    void notify() noexcept { workPending.store(true, std::memory_order_release); }
+    /** start the thread for the first user, and stop it once the last one is gone */
+    void addUser();
+    void removeUser();
+
+private:
+    DopplerBufferThread() = default;
+    void run();
+    static void serve(DopplerBuffer::Shared& buffers);
+    static constexpr std::chrono::milliseconds pollInterval {5};
+    std::atomic<bool> workPending {false};
+    // guards registered and shuttingDown, it is only held to copy the buffers to serve out of registered so add() never waits on the allocating and freeing
+    std::mutex mutex;
+    std::condition_variable changed; // for shutting down
+    std::vector<std::weak_ptr<DopplerBuffer::Shared>> registered;
+    bool shuttingDown = false;
+    std::thread thread;
+    // held while the thread is started or stopped
+    std::mutex usersMutex;
+    int numUsers = 0;
+};
+
+void DopplerBufferThread::addUser()
+{
+    const std::lock_guard<std::mutex> usersLock (usersMutex);
+    if (numUsers++ > 0)
+        return;
+    {
+        const std::lock_guard<std::mutex> lock (mutex);
+        shuttingDown = false;
+    }
+    thread = std::thread(&DopplerBufferThread::run, this);
+}
+
+void DopplerBufferThread::removeUser()
+{
+    const std::lock_guard<std::mutex> usersLock (usersMutex);
+    if (--numUsers > 0)
+        return;
+    {
+        const std::lock_guard<std::mutex> lock (mutex);
+        shuttingDown = true;
+    }
+    changed.notify_all();
+    thread.join();
+}
+
+constexpr std::chrono::milliseconds DopplerBufferThread::pollInterval;
+
+void DopplerBufferThread::run()
+{
+    std::vector<std::shared_ptr<DopplerBuffer::Shared>> serving;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock (mutex);
+            if (changed.wait_for(lock, pollInterval, [this] { return shuttingDown; }))
+                return;
+            // a notify() after this is picked up by the next poll
+            if (!workPending.exchange(false, std::memory_order_acq_rel))
+                continue;
+            for (auto i = registered.begin(); i != registered.end();) {
+                if (auto buffers = i->lock()) {
+                    serving.push_back(std::move(buffers));
+                    ++i;
+                } else {
+                    i = registered.erase(i);
+                }
+            }
+        }
+        for (const auto& buffers : serving)
+            serve(*buffers);
+        // the buffers of doppler effects that have gone away since are freed here too
+        serving.clear();
+    }
+}
+
+void DopplerBufferThread::serve(DopplerBuffer::Shared& buffers)
+{
+    if (!buffers.incomingReady.load(std::memory_order_acquire)) {
+        const auto size = buffers.requestedSize.exchange(0);
+        if (size > 0) {
+            buffers.incoming.assign(size, 0.0f);
+            buffers.incomingReady.store(true, std::memory_order_release);
+        } else if (buffers.incoming.capacity() > 0) {
+            // the old buffer the audio thread gave back (or a new one it did not need after all)
+            std::vector<float>().swap(buffers.incoming);
+        }
+    }
+    if (buffers.outgoingFull.load(std::memory_order_acquire)) {
+        std::vector<float>().swap(buffers.outgoing);
+        buffers.outgoingFull.store(false, std::memory_order_release);
+    }
+}
+
+/***** DopplerBuffer *****/
+DopplerBuffer::BackgroundThreadUser::BackgroundThreadUser()
+{
+    DopplerBufferThread::getInstance().addUser();
+}
+
+DopplerBuffer::BackgroundThreadUser::~BackgroundThreadUser()
+{
+    DopplerBufferThread::getInstance().removeUser();
+}
+
+DopplerBuffer::DopplerBuffer()
+    : shared(std::make_shared<Shared>())
+{
+    DopplerBufferThread::getInstance().add(shared);
+}
+
+void DopplerBuffer::allocate(const std::size_t size)
+{
+    samples.assign(size, 0.0f);
+}
+
+void DopplerBuffer::allocateInBackground(const std::size_t size) noexcept
+{
+	if (size <= samples.size() || size <= requestedSize)
+		return;
+	requestedSize = size;
+	shared->requestedSize.store(size, std::memory_order_release);
+	DopplerBufferThread::getInstance().notify();
+}
+
+void DopplerBuffer::free() noexcept
+{
+	samples.clear();
+}
+
+bool DopplerBuffer::freeInBackground() noexcept
+{
+	requestedSize = 0;
+	shared->requestedSize = 0;
+	if (samples.capacity() == 0)
+		return true;
+	if (shared->outgoingFull.load(std::memory_order_acquire))
+		return false;
+	shared->outgoing.swap(samples);
+	shared->outgoingFull.store(true, std::memory_order_release);
+	DopplerBufferThread::getInstance().notify();
+	return true;
+}
+
+std::vector<float>* DopplerBuffer::getGrown() noexcept
+{
+	if (!shared->incomingReady.load(std::memory_order_acquire))
+		return nullptr;
+	// a buffer asked for before the memory was freed (or smaller than the one since allocate()d) is not needed anymore
+	if (requestedSize > 0 && shared->incoming.size() > samples.size())
+		return &shared->incoming;
+	shared->incomingReady.store(false, std::memory_order_release);
+	DopplerBufferThread::getInstance().notify();
+	return nullptr;
+}
+
+void DopplerBuffer::swapInGrown() noexcept
+{
+	if (shared->incoming.size() >= requestedSize)
+		requestedSize = 0;
+	samples.swap(shared->incoming);
+	// the background thread frees the old buffer left in incoming
+	shared->incomingReady.store(false, std::memory_order_release);
+	DopplerBufferThread::getInstance().notify();
+}
+
+/***** DopplerDelayLine *****/
+void DopplerDelayLine::allocate(const float maxDistance, const int _maxBufferSize, const float speedOfSoundToPlanAllocationSize)
+{
+	const auto maxDelayInSamples = maxDistance / speedOfSoundToPlanAllocationSize * sampleRate;
+	maxBufferSize = _maxBufferSize;
+	buffer.allocate(std::size_t(maxBufferSize + maxDelayInSamples + 2 + numGuardSamples));
+	reset();
+}
+
+void DopplerDelayLine::allocateInBackground(const float maxDistance, const int _maxBufferSize, const float speedOfSoundToPlanAllocationSize) noexcept
+{
+	const auto maxDelayInSamples = maxDistance / speedOfSoundToPlanAllocationSize * sampleRate;
+	maxBufferSize = _maxBufferSize;
+	buffer.allocateInBackground(std::size_t(maxBufferSize + maxDelayInSamples + 2 + numGuardSamples));
+}
+
+void DopplerDelayLine::free() noexcept
+{
+	buffer.free();
+	reset();
+}
+
+void DopplerDelayLine::freeInBackground() noexcept
+{
+	if (buffer.freeInBackground())
+		reset();
+}
+
+void DopplerDelayLine::reset() noexcept
+{
+	for (auto& x : buffer.samples)
+		x = 0;
+	writeIdx = 0;
+	delayInUse = 0;
+}
+
+void DopplerDelayLine::setSampleRate(const float _sampleRate) noexcept
+{
+	sampleRate = _sampleRate;
+}
+
+void DopplerDelayLine::write(const float* input, const int bufferSize) noexcept
+{
+	if (std::vector<float>* grown = buffer.getGrown()) {
+		const int oldL = int(buffer.samples.size()) - numGuardSamples;
+		const int newL = int(grown->size()) - numGuardSamples;
+		// carry over the input history that the delays can reach back to, which ends up just before the new write index
+		const int live = oldL > 0 ? std::min(oldL, int(delayInUse) + maxBufferSize + numGuardSamples + 1) : 0;
+		for (int j = 0; j < live; ++j) {
+			int idx = writeIdx - live + j;
+			idx += (idx < 0) * oldL;
+			(*grown)[j] = buffer.samples[idx];
+		}
+		for (int j = 0; j < numGuardSamples; ++j)
+			(*grown)[newL + j] = (*grown)[j];
+		writeIdx = live;
+		buffer.swapInGrown();
+	}
+	delayInUse = 0;
+	if (!isAllocated())
+		return;
+	const int L = int(buffer.samples.size()) - numGuardSamples;
+	float* const x = &buffer.samples[0];
+	for (int n = 0; n < bufferSize; ++n) {
+		x[writeIdx] = input[n];
+		if (writeIdx < numGuardSamples)
+			x[L + writeIdx] = input[n];
+		writeIdx = writeIdx + 1 == L ? 0 : writeIdx + 1;
+	}
+}
+
+float DopplerDelayLine::reserve(const float delay) noexcept
+{
+	// the longest delay the buffer holds, a bigger one is asked for well before a reader gets there
+	const float maxDelay = std::max(2.0f, float(int(buffer.samples.size()) - numGuardSamples - maxBufferSize - 2));
+	if (delay > 0.75f * maxDelay)
+		buffer.allocateInBackground(std::size_t(maxBufferSize + 2 * delay + 2 + numGuardSamples));
+	delayInUse = std::max(delayInUse, std::min(delay, maxDelay));
+	return maxDelay;
+}
+
+void DopplerDelayLine::read(const float* delays, const int bufferSize, float* output) const noexcept
+{
+	if (!isAllocated()) { // the memory is still being allocated
+		for (int n = 0; n < bufferSize; ++n)
+			output[n] = 0;
+		return;
+	}
+	const int L = int(buffer.samples.size()) - numGuardSamples;
+	// output n reads the input at (start + n - delay), whose taps start at the sample before the one at or just below it, and mu is how far between those two it is
+	const int start = writeIdx - bufferSize < 0 ? writeIdx - bufferSize + L : writeIdx - bufferSize;
+	STACK_ARRAY(int, tapIdx, bufferSize)
+	STACK_ARRAY(float, mu, bufferSize)
+	for (int n = 0; n < bufferSize; ++n) {
+		const float d = delays[n];
+		const int k = int(d);
+		mu[n] = 1 - (d - k);
+		int idx = start + n - k - 2;
+		idx -= (idx >= L) * L;
+		idx += (idx < 0) * L;
+		tapIdx[n] = idx;
+	}
+	// cubic lagrange interpolation in farrow form, a polynomial in mu whose coefficients come from the 4 taps
+	const float* const buf = &buffer.samples[0];
+	for (int n = 0; n < bufferSize; ++n) {
+		const float* x = &buf[tapIdx[n]];
+		const float c0 = x[1];
+		const float c1 = x[2] - x[0] * (1.0f/3) - x[1] * 0.5f - x[3] * (1.0f/6);
+		const float c2 = (x[0] + x[2]) * 0.5f - x[1];
+		const float c3 = (x[3] - x[0]) * (1.0f/6) + (x[1] - x[2]) * 0.5f;
+		output[n] = ((c3 * mu[n] + c2) * mu[n] + c1) * mu[n] + c0;
+	}
+}
+
+/***** Doppler *****/
+Doppler::DelayCurve Doppler::nextDelayCurve(const float delay, const int bufferSize) noexcept
 {
-	const auto delay = distance / speedOfSound * sampleRate;
-	const auto cBufSize = buffer.size();
 	if (delayPrev == -1) {
 		delayPrev = delay;
 		prevSampleDelayedIdx = delay;
@@ -50,8 +352,30 @@ void Doppler::process(const float distance, const int bufferSize, const float* i
 	const auto a2 = _a2, a3 = _a3;
     const auto denom = a1*bufferSize + a2*bufferSize*bufferSize + a3*bufferSize*bufferSize*bufferSize;
 	const auto delayScale = denom == 0 ? 0 : (delay - delayPrev) / denom; // check for div by 0
+	slopePrev = slope;
+	delayPrev = delay;
+	return {a0, a1, a2, a3, delayScale};
+}
+
+void Doppler::process(const float distance, const int bufferSize, const float* input, float* output) noexcept
+{
+	takeGrownBuffer();
+	std::vector<float>& buffer = this->buffer.samples;
+	if (buffer.empty()) { // the memory is still being allocated
+		for (int n = 0; n < bufferSize; ++n)
+			output[n] = 0;
+		return;
+	}
+	// the longest delay the buffer holds, a bigger one is asked for well before the source gets there
+	const float maxDelay = int(buffer.size()) - maxBufferSize - 2;
+	auto delay = distance / speedOfSound * sampleRate;
+	if (delay > 0.75f * maxDelay)
+		this->buffer.allocateInBackground(std::size_t(maxBufferSize + 2 * delay + 2));
+	delay = std::min(delay, maxDelay);
+	const auto cBufSize = buffer.size();
+	const auto curve = nextDelayCurve(delay, bufferSize);
 	for (int n = 0; n < bufferSize; ++n) {
-		const auto delayedIdx = a0 + (a1*n + a2*n*n + a3*n*n*n) * delayScale;
+		const auto delayedIdx = curve.at(n);
 		auto fidx = bufferInIdx + delayedIdx;
 		while (fidx >= cBufSize)
 			fidx -= cBufSize;
@@ -87,8 +411,6 @@ void Doppler::process(const float distance, const int bufferSize, const float* i
 		prevSampleDelayedIdx = fidx;
 		bufferInIdx = bufferInIdx + 1 == cBufSize ? 0 : bufferInIdx + 1;
 	}
-	slopePrev = slope;
-	delayPrev = delay;
 	for (int n = 0; n < bufferSize; ++n) {
 		output[n] = buffer[bufferOutIdx];
 		buffer[bufferOutIdx] = 0;
@@ -96,22 +418,80 @@ void Doppler::process(const float distance, const int bufferSize, const float* i
 	}
 }
 
-void Doppler::allocate(const float maxDistance, const int maxBufferSize, const float speedOfSoundToPlanAllocationSize)
+void Doppler::process(const float distance, const int bufferSize, DopplerDelayLine& delayLine, float* output) noexcept
+{
+	const auto delay = distance / speedOfSound * sampleRate;
+	const float maxDelay = delayLine.reserve(delay);
+	const auto curve = nextDelayCurve(std::min(delay, maxDelay), bufferSize);
+	// the delay curve reaches this buffer's delay at its last sample, and is kept far enough from the input just written that all of the interpolation taps are in the delay line
+	STACK_ARRAY(float, delays, bufferSize)
+	for (int n = 0; n < bufferSize; ++n)
+		delays[n] = std::min(std::max(curve.at(n + 1), 2.0f), maxDelay);
+	delayLine.read(delays, bufferSize, output);
+}
+
+void Doppler::takeGrownBuffer() noexcept
+{
+	std::vector<float>* const grown = buffer.getGrown();
+	if (!grown)
+		return;
+	std::vector<float>& old = buffer.samples;
+	const int oldL = int(old.size());
+	if (oldL == 0 || delayPrev == -1) {
+		resetIndices(); // grown comes zeroed
+	} else {
+		// carry over the output waiting to be played, which ends up starting at the new output index
+		const int live = std::min(oldL, int(delayPrev) + 2 * maxBufferSize + 2);
+		const int outIdx = int(bufferOutIdx);
+		for (int j = 0; j < live; ++j) {
+			int idx = outIdx + j;
+			idx -= (idx >= oldL) * oldL;
+			(*grown)[j] = old[idx];
+		}
+		const auto rebase = [outIdx, oldL] (const float idx) { return idx < outIdx ? idx - outIdx + oldL : idx - outIdx; };
+		bufferInIdx = rebase(bufferInIdx);
+		prevSampleDelayedIdx = rebase(prevSampleDelayedIdx);
+		bufferOutIdx = 0;
+	}
+	buffer.swapInGrown();
+}
+
+void Doppler::allocate(const float maxDistance, const int _maxBufferSize, const float speedOfSoundToPlanAllocationSize)
 {
 	const auto maxDelayInSamples = maxDistance / speedOfSoundToPlanAllocationSize * sampleRate;
-	buffer.resize(maxBufferSize + maxDelayInSamples);
+	maxBufferSize = _maxBufferSize;
+	buffer.allocate(std::size_t(maxBufferSize + maxDelayInSamples + 2));
 	reset();
 }
 
+void Doppler::allocateInBackground(const float maxDistance, const int _maxBufferSize, const float speedOfSoundToPlanAllocationSize) noexcept
+{
+	const auto maxDelayInSamples = maxDistance / speedOfSoundToPlanAllocationSize * sampleRate;
+	maxBufferSize = _maxBufferSize;
+	buffer.allocateInBackground(std::size_t(maxBufferSize + maxDelayInSamples + 2));
+}
+
 void Doppler::free() noexcept
 {
-	buffer.clear();
+	buffer.free();
+}
+
+void Doppler::freeInBackground() noexcept
+{
+	// the indices are only reset with the memory going, calling this with nothing to free leaves the delay curve as it is
+	if (isAllocated() && buffer.freeInBackground())
+		resetIndices();
 }
 
 void Doppler::reset() noexcept
 {
-	for (auto& x : buffer)
+	for (auto& x : buffer.samples)
 		x = 0;
+	resetIndices();
+}
+
+void Doppler::resetIndices() noexcept
+{
 	delayPrev = -1;
 	slopePrev = 0;
 	bufferInIdx = bufferOutIdx = 0;
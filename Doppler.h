@@ -29,20 +29,128 @@
 #define __Doppler__
 
 #include <vector>
+#include <memory>
+#include <atomic>
 
 static constexpr float defaultSpeedOfSound = 343.0f; // in meters/sec
+// the distance the doppler effect's memory is allocated for up front, at the slowest speed of sound
+static constexpr float defaultDopplerMaxDistance = 20.0f; // in meters
+static constexpr float minDopplerSpeedOfSound = 0.1f; // in meters/sec
+
+// how the delayed input is put together.
+// SCATTER spreads each input sample of a source's output over the output samples between it and the previous one at their delays (linearly interpolated), so its cost per sample grows with how fast the source moves.
+// FRACTIONAL_DELAY reads each sample of a source's input from the DopplerDelayLine shared by all of the sources at its delay with cubic lagrange interpolation (farrow structure), which costs the same for every sample.
+enum class DopplerEngine { SCATTER, FRACTIONAL_DELAY };
+
+// the memory of a doppler effect, which is only allocated or freed on the calling thread by allocate() and free(), the rest is realtime safe.
+// a bigger buffer is asked of a background thread with allocateInBackground() and comes back through getGrown() once it is ready, so that the owner can copy over what it still needs and swapInGrown()
+class DopplerBuffer
+{
+public:
+    DopplerBuffer();
+    // copies register their own state with the background thread
+    DopplerBuffer(const DopplerBuffer& other) : DopplerBuffer() { samples = other.samples; }
+    DopplerBuffer& operator=(const DopplerBuffer& other) { samples = other.samples; return *this; }
+    /** make the buffer size samples of zeros */
+    void allocate(std::size_t size);
+    /** ask the background thread for a buffer of size samples if this one is smaller */
+    void allocateInBackground(std::size_t size) noexcept;
+    /** free the buffer */
+    void free() noexcept;
+    /** hand the buffer to the background thread to free, returns false if the last one handed off is still being freed and this has to be tried again later */
+    bool freeInBackground() noexcept;
+    /** a bigger buffer (of zeros) asked for with allocateInBackground() once it is ready, nullptr until then */
+    std::vector<float>* getGrown() noexcept;
+    /** swap in the buffer returned by getGrown(), the old one is freed in the background */
+    void swapInGrown() noexcept;
+    std::vector<float> samples;
+
+    // keeps the background thread going while any of these are around, the plugin instances each hold one so that it is stopped along with the last of them (joining it in a static destructor can deadlock while the plugin is unloaded)
+    class BackgroundThreadUser
+    {
+    public:
+        BackgroundThreadUser();
+        ~BackgroundThreadUser();
+        BackgroundThreadUser(const BackgroundThreadUser&) = delete;
+        BackgroundThreadUser& operator=(const BackgroundThreadUser&) = delete;
+    };
+
+    // the state shared with the background thread, each of the buffers is only touched by one side at a time
+    struct Shared
+    {
+        // the background thread allocates this for the audio thread and sets incomingReady, the audio thread swaps it in and gives it back to be freed
+        std::vector<float> incoming;
+        std::atomic<bool> incomingReady {false};
+        // size of the buffer the audio thread asks for
+        std::atomic<std::size_t> requestedSize {0};
+        // the audio thread moves the buffer here and sets outgoingFull for the background thread to free it
+        std::vector<float> outgoing;
+        std::atomic<bool> outgoingFull {false};
+    };
+private:
+    std::shared_ptr<Shared> shared;
+    // largest buffer size asked of the background thread since the buffer last changed
+    std::size_t requestedSize = 0;
+};
+
+// the mono input history that every source's (and ear's) fractional delay doppler effect reads at its own delays, kept once instead of once per ear of each source.
+// when a reader's delay nears what it holds, a bigger buffer is asked for in the background and swapped in by the next write() (carrying over the history still being read), until then the delays are held at the longest one it holds.
+class DopplerDelayLine
+{
+public:
+    /** allocate enough memory for the delays of a maximum sound source distance (in meters) at a minimum speed of sound (in m/s), and a maximum buffer size */
+	void allocate(float maxDistance, int maxBufferSize, float speedOfSoundToPlanAllocationSize);
+    /** allocate() on the background thread, for use on the audio thread, the readers get silence until it is ready */
+	void allocateInBackground(float maxDistance, int maxBufferSize, float speedOfSoundToPlanAllocationSize) noexcept;
+    /** free all memory */
+	void free() noexcept;
+    /** free() on the background thread, for use on the audio thread, tried again by each call until it goes through */
+	void freeInBackground() noexcept;
+    /** clear the input history */
+	void reset() noexcept;
+    /** specify the sample rate of the audio being processed */
+	void setSampleRate(float sampleRate) noexcept;
+	float getSampleRate() const noexcept { return sampleRate; }
+    /** add a buffer of input to the history before it is read */
+	void write(const float* input, int bufferSize) noexcept;
+    /** the longest delay (in samples) that can be read, which is bigger than delay or else the background thread is asked for more memory */
+	float reserve(float delay) noexcept;
+    /** read the buffer just written at a delay (in samples, 2 to reserve()) for each of its samples */
+	void read(const float* delays, int bufferSize, float* output) const noexcept;
+	bool isAllocated() const noexcept { return !buffer.samples.empty(); }
+private:
+    // samples past the end of the buffer that repeat its first ones, so that the interpolation never wraps around
+    static constexpr int numGuardSamples = 3;
+	DopplerBuffer buffer;
+	// maximum buffer size allocated for
+	int maxBufferSize = 0;
+	// next index to write input to
+	int writeIdx = 0;
+	// longest delay reserved by the readers of the last buffer written, how much history a grown buffer has to carry over
+	float delayInUse = 0;
+	// sample rate (in Hz)
+	float sampleRate = 44100;
+};
 
 class Doppler
 {
 public:
 	/*Doppler() noexcept;
 	~Doppler();*/
-    /** process an input audio buffer at certain distance from the listener such that the doppler effect is applied to output */
+    /** process an input audio buffer at certain distance from the listener such that the doppler effect is applied to output (SCATTER), which is silent until there is memory for the doppler effect.
+        when the delay nears what the memory holds, a bigger buffer is asked for in the background and swapped in (carrying over the delayed audio) once it is ready, until then the delay is held at the longest one the memory allows */
 	void process(float distance, int bufferSize, const float* input, float* output) noexcept;
+    /** read the buffer just written to delayLine at the delay of a certain distance from the listener such that the doppler effect is applied to output (FRACTIONAL_DELAY), this needs none of the doppler effect's own memory */
+	void process(float distance, int bufferSize, DopplerDelayLine& delayLine, float* output) noexcept;
     /** allocate enough memory for the doppler effect given a maximum sound source distance (in meters), maximum buffer size, and minimum speed of sound (in m/s) */
 	void allocate(float maxDistance, int maxBufferSize, float speedOfSoundToPlanAllocationSize);
+    /** allocate() on the background thread, for use on the audio thread */
+	void allocateInBackground(float maxDistance, int maxBufferSize, float speedOfSoundToPlanAllocationSize) noexcept;
     /** free all memory */
 	void free()	noexcept;
+    /** free() on the background thread, for use on the audio thread, tried again by each call until it goes through */
+	void freeInBackground() noexcept;
+	bool isAllocated() const noexcept { return !buffer.samples.empty(); }
     /** reset the doppler effect state */
 	void reset() noexcept;
     /** specify the sample rate of the audio being processed */
@@ -50,8 +158,19 @@ public:
     /** set the speed of sound for the doppler effect */
 	void setSpeedOfSound(float speedOfSound) noexcept;
 private:
+    // the delay (in samples) over a buffer, which moves smoothly from the previous buffer's delay to the current one
+    struct DelayCurve
+    {
+        float a0, a1, a2, a3, scale;
+        float at(const float n) const noexcept { return a0 + (a1*n + a2*n*n + a3*n*n*n) * scale; }
+    };
+    DelayCurve nextDelayCurve(float delay, int bufferSize) noexcept;
+    void takeGrownBuffer() noexcept;
+    void resetIndices() noexcept;
+	// maximum buffer size allocated for
+	int maxBufferSize = 0;
 	// circular buffer for holding delayed input
-	std::vector<float> buffer;
+	DopplerBuffer buffer;
 	// next index to insert input in circular buffer
 	float bufferInIdx = 0;
 	// next index to output from circular buffer
@@ -0,0 +1,480 @@
+//
+//  HRIRTable.cpp
+//  ThreeDAudio
+//
+//
+/*
+     3DAudio: simulates surround sound audio for headphones
+     Copyright (C) 2016  Andrew Barker
+
+     This program is free software: you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation, either version 3 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+     The author can be contacted via email at andrew.barker.12345@gmail.com.
+ */
+
+#include "HRIRTable.h"
+#include <cstdint>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <fstream>
+#include <array>
+
+static constexpr std::size_t tableAlignment = HRIRTableFileAlignment;
+static constexpr std::size_t tableSize = std::size_t(numDistanceSteps) * HRIRTable::rowsPerDistance * HRIRTable::rowSize;
+
+float* HRIRTable::allocate(const std::size_t size)
+{
+    mappedFile = nullptr;
+    const std::size_t padding = tableAlignment / sizeof(float);
+    storage.assign(size + padding, 0.0f);
+    const std::uintptr_t address = reinterpret_cast<std::uintptr_t>(storage.data());
+    const std::uintptr_t aligned = (address + tableAlignment - 1) & ~std::uintptr_t(tableAlignment - 1);
+    float* table = storage.data() + (aligned - address) / sizeof(float);
+    data = table;
+    normStorage.assign(size / numTimeSteps, 0.0f);
+    normData = normStorage.data();
+    basis = farFieldData = nullptr;
+    numComponents = numCorrectionTaps = 0;
+    channelSize = numTimeSteps;
+    rowStride = size == tableSize ? rowSize : 0;
+    sampleRate = int(sampleRate_HRTF);
+    return table;
+}
+
+bool HRIRTable::load(std::istream& is, const std::function<bool(float)>& keepLoading)
+{
+    float* table = allocate(tableSize);
+    // the file has all of the elevations between the poles for every distance, which are already in row order
+    const std::size_t rowsSize = std::size_t(rowsPerDistance - 2) * rowSize;
+    bool loading = true;
+    for (int d = 0; d < numDistanceSteps && loading; ++d) {
+        is.read((char*)&table[d * rowsPerDistance * rowSize], rowsSize * sizeof(float));
+        loading = !keepLoading || keepLoading(float(d + 1) / (numDistanceSteps + 1));
+    }
+    // followed by the pole data for every distance, which is the same for both channels
+    for (int d = 0; d < numDistanceSteps && loading; ++d) {
+        for (int p = 0; p < 2; ++p) {
+            float* pole = &table[(d * rowsPerDistance + rowsPerDistance - 2 + p) * rowSize];
+            is.read((char*)pole, numTimeSteps * sizeof(float));
+            std::copy_n(pole, numTimeSteps, &pole[numTimeSteps]);
+        }
+    }
+    if (!is || !loading) {
+        loadZeros();
+        return false;
+    }
+    computeNorms();
+    return true;
+}
+
+void HRIRTable::computeNorms()
+{
+    for (std::size_t i = 0; i < normStorage.size(); ++i) {
+        float norm = 0;
+        for (int n = 0; n < numTimeSteps; ++n)
+            norm += std::abs(data[i*numTimeSteps + n]);
+        normStorage[i] = norm;
+    }
+}
+
+bool HRIRTable::loadMapped(const File& file, const int sampleRate, const File& sourceFile)
+{
+    const bool checkSource = sourceFile != File();
+    if (!file.existsAsFile() || (checkSource && !sourceFile.existsAsFile()))
+        return false;
+    std::unique_ptr<MemoryMappedFile> map (new MemoryMappedFile(file, MemoryMappedFile::readOnly));
+    if (map->getData() == nullptr || map->getSize() < sizeof(HRIRTableFileHeader))
+        return false;
+    // everything but the compression must match this build's table at sampleRate, and a table can not be both compressed and distance factorized
+    HRIRTableFileHeader header, expected;
+    std::memcpy(&header, map->getData(), sizeof(header));
+    expected.sampleRate = sampleRate;
+    expected.numComponents = header.numComponents;
+    expected.numCorrectionTaps = header.numCorrectionTaps;
+    expected.sourceSize = checkSource ? sourceFile.getSize() : header.sourceSize;
+    expected.sourceModificationTime = checkSource ? sourceFile.getLastModificationTime().toMilliseconds() : header.sourceModificationTime;
+    if (std::memcmp(&header, &expected, sizeof(header)) != 0
+        || header.numComponents < 0 || header.numComponents > numTimeSteps
+        || header.numCorrectionTaps < 0 || header.numCorrectionTaps > HRIRTableFileMaxCorrectionTaps
+        || (header.numComponents > 0 && header.numCorrectionTaps > 0)
+        || map->getSize() != sizeof(header) + header.getDataSize() * sizeof(float))
+        return false;
+    storage.clear();
+    storage.shrink_to_fit();
+    normStorage.clear();
+    normStorage.shrink_to_fit();
+    const float* fileData = reinterpret_cast<const float*>(static_cast<const char*>(map->getData()) + sizeof(header));
+    numComponents = header.numComponents;
+    if (numComponents > 0) {
+        basis = fileData;
+        data = fileData + numComponents * numTimeSteps;
+        channelSize = numComponents;
+    } else {
+        basis = nullptr;
+        data = fileData;
+        channelSize = numTimeSteps;
+    }
+    rowStride = 2 * channelSize;
+    numCorrectionTaps = header.numCorrectionTaps;
+    if (numCorrectionTaps > 0) {
+        farFieldData = data;
+        data = farFieldData + rowsPerDistance * rowSize;
+        rowStride = 2 * numCorrectionTaps;
+    } else {
+        farFieldData = nullptr;
+    }
+    normData = fileData + header.getDataSize() - header.getNumNorms();
+    this->sampleRate = sampleRate;
+    mappedFile = std::move(map);
+    return true;
+}
+
+bool HRIRTable::save(const File& file, const File& sourceFile) const
+{
+    if (!isLoaded() || rowStride != rowSize || file.getParentDirectory().createDirectory().failed())
+        return false;
+    TemporaryFile temp (file);
+    {
+        FileOutputStream os (temp.getFile());
+        if (os.failedToOpen())
+            return false;
+        HRIRTableFileHeader header;
+        header.sampleRate = sampleRate;
+        if (sourceFile != File()) {
+            header.sourceSize = sourceFile.getSize();
+            header.sourceModificationTime = sourceFile.getLastModificationTime().toMilliseconds();
+        }
+        if (!os.write(&header, sizeof(header)) || !os.write(data, tableSize * sizeof(float)) || !os.write(normData, header.getNumNorms() * sizeof(float)))
+            return false;
+        os.flush();
+        if (os.getStatus().failed())
+            return false;
+    }
+    return temp.overwriteTargetFileWithTemporary();
+}
+
+bool HRIRTable::resample(const HRIRTable& source, const int newSampleRate, const std::function<bool(float)>& keepLoading)
+{
+    if (source.rowStride == 0) {
+        loadZeros();
+        return true;
+    }
+    // each new tap is a blackman windowed sinc interpolation of the source taps around its time, which is also low passed below the new nyquist frequency when going down in rate.
+    // the interpolation is scaled by the ratio of the rates so that the hrirs' frequency responses stay the same, and when going up in rate the hrirs are faded out over their last taps since their tails are cut off.
+    // the kernel only depends on the tap, so it is worked out once for the whole table
+    const double pi = M_PI;
+    const double ratio = double(source.sampleRate) / newSampleRate; // source taps per new tap
+    const double cutoff = std::min(1.0, 1.0 / ratio);
+    const double halfWidth = 16 / cutoff; // in source taps
+    constexpr int numFadeTaps = 8;
+    std::vector<float> kernel (numTimeSteps * numTimeSteps, 0.0f);
+    for (int n = 0; n < numTimeSteps; ++n) {
+        const double t = n * ratio;
+        const double fade = ratio < 1 && n >= numTimeSteps - numFadeTaps ? 0.5 + 0.5 * std::cos(pi * (n - (numTimeSteps - numFadeTaps) + 1) / (numFadeTaps + 1)) : 1;
+        for (int k = std::max(0, int(std::ceil(t - halfWidth))); k <= std::min(numTimeSteps - 1, int(std::floor(t + halfWidth))); ++k) {
+            const double x = t - k;
+            const double sinc = x == 0 ? 1 : std::sin(pi * cutoff * x) / (pi * cutoff * x);
+            const double window = 0.42 + 0.5 * std::cos(pi * x / halfWidth) + 0.08 * std::cos(2 * pi * x / halfWidth);
+            kernel[n * numTimeSteps + k] = float(fade * ratio * cutoff * sinc * window);
+        }
+    }
+    float* table = allocate(tableSize);
+    sampleRate = newSampleRate;
+    std::array<float, rowSize> hrir;
+    for (int d = 0; d < numDistanceSteps; ++d) {
+        for (int r = 0; r < rowsPerDistance; ++r) {
+            const std::size_t index = std::size_t(d * rowsPerDistance + r);
+            source.reconstruct(&source.data[index * source.rowStride], hrir.data());
+            float* resampled = &table[index * rowSize];
+            for (int ch = 0; ch < 2; ++ch) {
+                const float* x = &hrir[ch * numTimeSteps];
+                for (int n = 0; n < numTimeSteps; ++n) {
+                    const float* h = &kernel[n * numTimeSteps];
+                    float sum = 0;
+                    for (int k = 0; k < numTimeSteps; ++k)
+                        sum += h[k] * x[k];
+                    resampled[ch * numTimeSteps + n] = sum;
+                }
+            }
+        }
+        if (keepLoading && !keepLoading(float(d + 1) / numDistanceSteps)) {
+            loadZeros();
+            return false;
+        }
+    }
+    computeNorms();
+    return true;
+}
+
+void HRIRTable::reconstruct(const float* row, float* hrir) const noexcept
+{
+    for (int ch = 0; ch < 2; ++ch) {
+        float* h = &hrir[ch * numTimeSteps];
+        if (numCorrectionTaps > 0) {
+            const float* x = &farField(row)[ch * numTimeSteps];
+            const float* c = &row[ch * numCorrectionTaps];
+            std::fill_n(h, numTimeSteps, 0.0f);
+            for (int t = 0; t < numCorrectionTaps; ++t)
+                for (int n = t; n < numTimeSteps; ++n)
+                    h[n] += c[t] * x[n-t];
+        } else if (basis) {
+            const float* weights = &row[ch * numComponents];
+            std::fill_n(h, numTimeSteps, 0.0f);
+            for (int k = 0; k < numComponents; ++k)
+                for (int n = 0; n < numTimeSteps; ++n)
+                    h[n] += weights[k] * basis[k * numTimeSteps + n];
+        } else {
+            std::copy_n(&row[ch * numTimeSteps], numTimeSteps, h);
+        }
+    }
+}
+
+void HRIRTable::loadZeros()
+{
+    allocate(rowSize);
+}
+
+void HRIRTable::clear()
+{
+    mappedFile = nullptr;
+    storage.clear();
+    storage.shrink_to_fit();
+    normStorage.clear();
+    normStorage.shrink_to_fit();
+    data = basis = farFieldData = normData = nullptr;
+}
+
+/***** HRIRTableLoader *****/
+HRIRTableLoader::~HRIRTableLoader()
+{
+    stop();
+}
+
+void HRIRTableLoader::start(const File& dataFile, const File& tableFile, const int sampleRate)
+{
+    stop();
+    cancel = false;
+    progress = 0;
+    this->sampleRate = sampleRate;
+    thread = std::thread(&HRIRTableLoader::load, this, dataFile, tableFile);
+}
+
+void HRIRTableLoader::stop()
+{
+    cancel = true;
+    if (thread.joinable())
+        thread.join();
+    published.store(nullptr, std::memory_order_release);
+    table.clear();
+}
+
+void HRIRTableLoader::load(File dataFile, File tableFile)
+{
+    // a table at another rate than the data's own is resampled from it, otherwise a compressed table next to the data file is used over the full one,
+    // and a cached table is only used if it was converted from the data file as it is now.
+    // the data file itself can not be indexed in place, it holds each pole's hrir once for both ears after all of the distances and has no norms, so it is converted to the table's layout once
+    if (sampleRate != int(sampleRate_HRTF))
+        loadResampled(dataFile, tableFile);
+    else if (!table.loadMapped(dataFile.getSiblingFile(dataFile.getFileNameWithoutExtension() + "Compressed.hrir"))
+        && !table.loadMapped(dataFile.getSiblingFile(tableFile.getFileName()))
+        && !table.loadMapped(tableFile, int(sampleRate_HRTF), dataFile)) {
+        // basic read (should be cross platform)
+        // open the stream
+        std::ifstream is(dataFile.getFullPathName().getCharPointer(), std::ios::binary);
+        if (is.good() && table.load(is, [this] (float fractionLoaded) { progress = fractionLoaded; return !cancel; })) {
+            is.close();
+            // convert for next time, and map the converted table now so the heap copy is released
+            if (!cancel && table.save(tableFile, dataFile))
+                table.loadMapped(tableFile, int(sampleRate_HRTF), dataFile);
+        } else if (!cancel) {
+            // failed to open hrtf binary file, load up zeros
+            table.loadZeros();
+        }
+    }
+    if (!cancel) {
+        published.store(&table, std::memory_order_release);
+        progress = 1;
+    }
+}
+
+constexpr int HRIRTableLoader::maxNumResampledCaches;
+
+void HRIRTableLoader::loadResampled(const File& dataFile, const File& tableFile)
+{
+    const File resampledFile = tableFile.getSiblingFile(tableFile.getFileNameWithoutExtension() + String(sampleRate) + "Hz.hrir");
+    if (table.loadMapped(dataFile.getSiblingFile(resampledFile.getFileName()), sampleRate))
+        return;
+    if (table.loadMapped(resampledFile, sampleRate, dataFile)) {
+        // the access time says which caches were used most recently, see below
+        resampledFile.setLastAccessTime(Time::getCurrentTime());
+        return;
+    }
+    // a cache made from another data file (or by another version of the plugin) is of no use again
+    if (dataFile.existsAsFile())
+        resampledFile.deleteFile();
+    // resample the table at the data's own rate, which any instances running at that rate share with this
+    const std::shared_ptr<const HRIRTableLoader> source = HRIRStore::acquire(dataFile, tableFile);
+    const HRIRTable* sourceTable = nullptr;
+    while (!cancel && (sourceTable = source->getTable()) == nullptr) {
+        progress = 0.5f * source->getProgress();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (!cancel && table.resample(*sourceTable, sampleRate, [this] (float fractionResampled) { progress = 0.5f + 0.5f * fractionResampled; return !cancel; })) {
+        // cache it for next time, and map the cached table now so the heap copy is released
+        if (!cancel && table.save(resampledFile, dataFile)) {
+            table.loadMapped(resampledFile, sampleRate, dataFile);
+            resampledFile.setLastAccessTime(Time::getCurrentTime());
+            // delete the caches of the rates used least recently beyond the limit, a mapped one stays readable until it is unmapped on all but windows, where deleting it fails and it is tried again next time
+            Array<File> caches;
+            tableFile.getParentDirectory().findChildFiles(caches, File::findFiles, false, tableFile.getFileNameWithoutExtension() + "*Hz.hrir");
+            std::sort(caches.begin(), caches.end(), [] (const File& a, const File& b) { return a.getLastAccessTime() > b.getLastAccessTime(); });
+            for (int i = maxNumResampledCaches; i < caches.size(); ++i)
+                caches[i].deleteFile();
+        }
+    } else if (!cancel) {
+        table.loadZeros();
+    }
+}
+
+/***** HRIRStore *****/
+constexpr std::chrono::milliseconds HRIRStore::defaultGracePeriod;
+
+HRIRStore::User::User()
+{
+    getInstance().addUser();
+}
+
+HRIRStore::User::~User()
+{
+    getInstance().removeUser();
+}
+
+void HRIRStore::addUser()
+{
+    const std::lock_guard<std::mutex> usersLock (usersMutex);
+    if (numUsers++ > 0)
+        return;
+    {
+        const std::lock_guard<std::mutex> lock (mutex);
+        shuttingDown = false;
+    }
+    freeThread = std::thread(&HRIRStore::freeUnusedData, this);
+}
+
+void HRIRStore::removeUser()
+{
+    const std::lock_guard<std::mutex> usersLock (usersMutex);
+    if (--numUsers > 0)
+        return;
+    {
+        const std::lock_guard<std::mutex> lock (mutex);
+        shuttingDown = true;
+    }
+    changed.notify_all();
+    freeThread.join();
+    // free all of the data now, a loader resampling the data acquire()s it from here (and stopping it releases that), so keep going until there are none left
+    for (;;) {
+        std::vector<std::shared_ptr<HRIRTableLoader>> loaders;
+        {
+            const std::lock_guard<std::mutex> lock (mutex);
+            for (auto& d : data)
+                if (d.second.loader)
+                    loaders.push_back(std::move(d.second.loader));
+        }
+        if (loaders.empty())
+            break;
+    }
+    const std::lock_guard<std::mutex> lock (mutex);
+    data.clear();
+}
+
+HRIRStore& HRIRStore::getInstance()
+{
+    static HRIRStore store;
+    return store;
+}
+
+std::shared_ptr<const HRIRTableLoader> HRIRStore::acquire(const File& dataFile, const File& tableFile, const int sampleRate)
+{
+    HRIRStore& store = getInstance();
+    std::shared_ptr<HRIRTableLoader> loader;
+    {
+        const std::lock_guard<std::mutex> lock (store.mutex);
+        Data& data = store.data[sampleRate];
+        if (!data.loader) {
+            data.loader = std::make_shared<HRIRTableLoader>();
+            data.loader->start(dataFile, tableFile, sampleRate);
+        }
+        ++data.numUsers;
+        loader = data.loader;
+    }
+    store.changed.notify_all();
+    // the user's pointer keeps the data alive and tells the store when it goes away
+    return std::shared_ptr<const HRIRTableLoader>(loader.get(), [loader, sampleRate] (const HRIRTableLoader*) { getInstance().release(sampleRate); });
+}
+
+void HRIRStore::setGracePeriod(const std::chrono::milliseconds newGracePeriod)
+{
+    HRIRStore& store = getInstance();
+    {
+        const std::lock_guard<std::mutex> lock (store.mutex);
+        store.gracePeriod = newGracePeriod;
+    }
+    store.changed.notify_all();
+}
+
+void HRIRStore::release(const int sampleRate)
+{
+    {
+        const std::lock_guard<std::mutex> lock (mutex);
+        // the data is only gone if the last user went away first, see removeUser()
+        const auto d = data.find(sampleRate);
+        if (d == data.end())
+            return;
+        jassert(d->second.numUsers > 0);
+        if (--d->second.numUsers == 0)
+            d->second.releaseTime = std::chrono::steady_clock::now();
+    }
+    changed.notify_all();
+}
+
+void HRIRStore::freeUnusedData()
+{
+    std::unique_lock<std::mutex> lock (mutex);
+    while (!shuttingDown) {
+        // the unused data whose grace period is up first
+        auto d = data.end();
+        for (auto i = data.begin(); i != data.end(); ++i)
+            if (i->second.loader && i->second.numUsers == 0 && (d == data.end() || i->second.releaseTime < d->second.releaseTime))
+                d = i;
+        if (d == data.end()) {
+            changed.wait(lock);
+            continue;
+        }
+        // wait out the grace period, starting over if any data gets used or released (or the grace period changes) in the meantime
+        Data& unusedData = d->second;
+        const auto deadline = unusedData.releaseTime + gracePeriod;
+        const auto released = unusedData.releaseTime;
+        const auto period = gracePeriod;
+        if (changed.wait_until(lock, deadline, [&] { return shuttingDown || unusedData.numUsers > 0 || unusedData.releaseTime != released || gracePeriod != period; }))
+            continue;
+        // nobody has used the data for the whole grace period, stopping the loader can wait on a load in progress (which may release other data) so don't hold the lock for that
+        std::shared_ptr<HRIRTableLoader> unused = std::move(unusedData.loader);
+        data.erase(d);
+        lock.unlock();
+        unused = nullptr;
+        lock.lock();
+    }
+}
@@ -0,0 +1,224 @@
+//
+//  HRIRTable.h
+//  ThreeDAudio
+//
+//
+/*
+     3DAudio: simulates surround sound audio for headphones
+     Copyright (C) 2016  Andrew Barker
+
+     This program is free software: you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation, either version 3 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+     The author can be contacted via email at andrew.barker.12345@gmail.com.
+ */
+
+#ifndef HRIRTable_h
+#define HRIRTable_h
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "Data.h"
+#include "HRIRTableFile.h"
+#include <vector>
+#include <istream>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <map>
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+  #include <xmmintrin.h>
+  #define HRIR_PREFETCH(address) _mm_prefetch((const char*)(address), _MM_HINT_T1)
+#elif defined(__GNUC__)
+  #define HRIR_PREFETCH(address) __builtin_prefetch(address, 0, 2)
+#else
+  #define HRIR_PREFETCH(address)
+#endif
+
+// all of the hrir data in one contiguous, cache line aligned allocation.
+// the data is compacted to one azimuth side (the other side is the same with the channels swapped), and each row holds both channels of one hrir ([ch][t]).
+// per distance there are numAzimuths*(numElevationSteps-1) rows for the elevations between the poles followed by the two pole rows, whose channels are the same.
+// the table can also be memory mapped from a file holding a 128 byte header followed by this exact layout, so that it is indexed in place and its pages are shared by every process using it (see HRIRTableFile.h).
+// a mapped table may be compressed, in which case each channel of a row holds the weights of a shared basis of hrirs (Tools/BuildCompressedHRIRs.cpp builds these files).
+// or it may be distance factorized, in which case the rows hold short correction filters for the far field hrir of the same direction, see farField().
+// the hrirs are at the data's own sample rate (sampleRate_HRTF) unless the table was resample()d to another one.
+class HRIRTable
+{
+public:
+    static constexpr int numAzimuths = numAzimuthSteps/2 + 1;
+    static constexpr int rowSize = 2 * numTimeSteps;
+    static constexpr int rowsPerDistance = numAzimuths * (numElevationSteps - 1) + 2;
+
+    /** read the data in the 3DAudioData.bin layout, returns false (and leaves the table zeroed) if the stream ran out of data or keepLoading returned false.
+        keepLoading (if given) is called with the fraction of the data read so far */
+    bool load(std::istream& is, const std::function<bool(float)>& keepLoading = nullptr);
+    /** memory map a table file written by save() or the compressed table builder, returns false (and leaves the table as it was) if the file does not exist or does not match this build's table dimensions and sampleRate.
+        if a sourceFile is given, the table must also have been saved from it as it is now (the same size and modification time), so nothing is mapped if it does not exist */
+    bool loadMapped(const File& file, int sampleRate = int(sampleRate_HRTF), const File& sourceFile = File());
+    /** make a full table of source's hrirs resampled to newSampleRate, which keep their numTimeSteps taps (so they are cut short when going up in rate), returns false (and leaves the table zeroed) if keepLoading returned false.
+        keepLoading (if given) is called with the fraction of the table resampled so far */
+    bool resample(const HRIRTable& source, int newSampleRate, const std::function<bool(float)>& keepLoading = nullptr);
+    /** write the loaded table to a file that can be memory mapped by loadMapped(), the file is replaced atomically so other processes never map a partial table.
+        the size and modification time of sourceFile (if given) are kept in the file for loadMapped() to check */
+    bool save(const File& file, const File& sourceFile = File()) const;
+    /** make a table of all zeros, which is one zero row that every index maps to */
+    void loadZeros();
+    /** free the table */
+    void clear();
+    bool isLoaded() const noexcept { return data != nullptr; }
+    bool isMapped() const noexcept { return mappedFile != nullptr; }
+    int getSampleRate() const noexcept { return sampleRate; }
+    /** the number of basis hrirs of a compressed table, 0 if the rows hold the hrirs themselves */
+    int getNumComponents() const noexcept { return numComponents; }
+    /** the basis hrirs of a compressed table, numComponents hrirs of numTimeSteps taps */
+    const float* getBasis() const noexcept { return basis; }
+    /** the size of each channel of a row, numTimeSteps or numComponents */
+    int getChannelSize() const noexcept { return channelSize; }
+    /** the L1 norms of the left and right channel of the hrir of a row (for compressed and distance factorized tables, the norms of the hrirs the row stands for) */
+    const float* norms(const float* row) const noexcept
+    {
+        return &normData[(rowStride > 0 ? (row - data) / rowStride : 0) * 2];
+    }
+    /** ask the cpu to start loading a row (and the far field hrir it corrects for distance factorized tables) into its cache ahead of being used */
+    void prefetch(const float* row) const noexcept
+    {
+        constexpr int floatsPerLine = HRIRTableFileAlignment / sizeof(float);
+        for (int i = 0; i < rowStride; i += floatsPerLine)
+            HRIR_PREFETCH(&row[i]);
+        if (numCorrectionTaps > 0) {
+            const float* hrir = farField(row);
+            for (int i = 0; i < rowSize; i += floatsPerLine)
+                HRIR_PREFETCH(&hrir[i]);
+        }
+    }
+    /** the length of each channel's correction filter of a distance factorized table, 0 if the rows hold the hrirs themselves */
+    int getNumCorrectionTaps() const noexcept { return numCorrectionTaps; }
+    /** the far field hrir (numTimeSteps taps per channel) of the same direction as a distance factorized table's row, which holds the filters that correct it for the row's distance */
+    const float* farField(const float* row) const noexcept
+    {
+        return &farFieldData[(row - data) / rowStride % rowsPerDistance * rowSize];
+    }
+    /** write out the full hrir (both channels of numTimeSteps taps) that a row holds or stands for */
+    void reconstruct(const float* row, float* hrir) const noexcept;
+
+    /** the row of the hrir at distance index d, compacted azimuth index a (0 to numAzimuthSteps/2), and elevation index e (0 and numElevationSteps are the poles, where a does not matter) */
+    const float* row(const int d, const int a, const int e) const noexcept
+    {
+        const int r = e == 0 ? rowsPerDistance - 2
+                    : e == numElevationSteps ? rowsPerDistance - 1
+                    : a * (numElevationSteps - 1) + e - 1;
+        return &data[(d * rowsPerDistance + r) * rowStride];
+    }
+    /** the row of the hrir of a pole (0 for elevation = 0, 1 for elevation = 180) at distance index d */
+    const float* pole(const int d, const int p) const noexcept
+    {
+        return &data[(d * rowsPerDistance + rowsPerDistance - 2 + p) * rowStride];
+    }
+
+private:
+    float* allocate(std::size_t size);
+    void computeNorms();
+    std::vector<float> storage;
+    std::vector<float> normStorage;
+    std::unique_ptr<MemoryMappedFile> mappedFile;
+    const float* data = nullptr; // aligned start of the table within storage or the mapped file
+    const float* basis = nullptr;
+    const float* farFieldData = nullptr;
+    const float* normData = nullptr;
+    int numComponents = 0;
+    int numCorrectionTaps = 0;
+    int channelSize = numTimeSteps;
+    int rowStride = rowSize; // 0 for the zeros table
+    int sampleRate = int(sampleRate_HRTF);
+};
+
+// loads the hrir table on a background thread so that creating a plugin instance never waits on the hrir file.
+// the table is published through an atomic pointer once it is completely loaded, until then getTable() returns nullptr.
+class HRIRTableLoader
+{
+public:
+    ~HRIRTableLoader();
+    /** start loading the table from the compressed (3DAudioDataCompressed.hrir) or full mappable table file next to dataFile (3DAudioData.bin), the one cached at tableFile, or else convert it from dataFile and cache it at tableFile.
+        for any other sampleRate than the data's own, the table is loaded from the file of that rate (3DAudioData48000Hz.hrir) next to dataFile or tableFile, or else it is resampled from the one at the data's own rate (which is acquire()d from the HRIRStore) and cached next to tableFile.
+        only the maxNumResampledCaches most recently used rates are kept cached next to tableFile, and a cache older than dataFile is deleted */
+    void start(const File& dataFile, const File& tableFile, int sampleRate = int(sampleRate_HRTF));
+    /** stop any loading in progress, then unpublish and free the table */
+    void stop();
+    const HRIRTable* getTable() const noexcept { return published.load(std::memory_order_acquire); }
+    /** fraction of the table loaded so far */
+    float getProgress() const noexcept { return progress; }
+    int getSampleRate() const noexcept { return sampleRate; }
+
+private:
+    void load(File dataFile, File tableFile);
+    void loadResampled(const File& dataFile, const File& tableFile);
+    // each resampled cache is about as big as the table at the data's own rate
+    static constexpr int maxNumResampledCaches = 2;
+    HRIRTable table;
+    std::atomic<const HRIRTable*> published {nullptr};
+    std::atomic<float> progress {0};
+    std::atomic<bool> cancel {false};
+    int sampleRate = int(sampleRate_HRTF);
+    std::thread thread;
+};
+
+// the process wide owner of the hrir data, which every plugin instance shares by holding on to what acquire() gives it.
+// once the data is let go of, it is kept loaded for a grace period so that using it again soon after (undoing a plugin delete, switching the sample rate back) does not load it again.
+// the data is kept once per sample rate it is used at.
+class HRIRStore
+{
+public:
+    // keeps the store's thread going while any of these are around, the plugin instances each hold one so that the store is shut down (freeing all of the data) along with the last of them.
+    // its threads are joined there rather than in a static destructor, which can deadlock while the plugin is unloaded
+    class User
+    {
+    public:
+        User();
+        ~User();
+        User(const User&) = delete;
+        User& operator=(const User&) = delete;
+    };
+    /** get the shared hrir data at sampleRate, starting to load it (see HRIRTableLoader::start()) if it is not already loaded */
+    static std::shared_ptr<const HRIRTableLoader> acquire(const File& dataFile, const File& tableFile, int sampleRate = int(sampleRate_HRTF));
+    /** how long the data stays loaded after the last acquire()d pointer to it goes away */
+    static void setGracePeriod(std::chrono::milliseconds newGracePeriod);
+    static constexpr std::chrono::milliseconds defaultGracePeriod {60 * 1000};
+
+private:
+    HRIRStore() = default;
+    static HRIRStore& getInstance();
+    void addUser();
+    void removeUser();
+    void release(int sampleRate);
+    void freeUnusedData(); // runs on freeThread
+    struct Data
+    {
+        std::shared_ptr<HRIRTableLoader> loader;
+        int numUsers = 0;
+        std::chrono::steady_clock::time_point releaseTime;
+    };
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::map<int, Data> data; // by sample rate
+    std::chrono::milliseconds gracePeriod = defaultGracePeriod;
+    bool shuttingDown = false;
+    std::thread freeThread;
+    // held while the store is started or shut down
+    std::mutex usersMutex;
+    int numUsers = 0;
+};
+
+#endif /* HRIRTable_h */
@@ -0,0 +1,79 @@
+//
+//  HRIRTableFile.h
+//  ThreeDAudio
+//
+//
+/*
+     3DAudio: simulates surround sound audio for headphones
+     Copyright (C) 2016  Andrew Barker
+
+     This program is free software: you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation, either version 3 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+     The author can be contacted via email at andrew.barker.12345@gmail.com.
+ */
+
+#ifndef HRIRTableFile_h
+#define HRIRTableFile_h
+
+#include "Data.h"
+#include <cstdint>
+#include <cstddef>
+
+// the layout of the memory mappable hrir table files that HRIRTable loads, kept free of JUCE so that the tools that build these files can use it too.
+// a file is this header, then (for compressed tables only) the basis of numComponents vectors of numTimeSteps taps, then the table's rows.
+// for every distance there are numAzimuths*(numElevationSteps-1) rows for the elevations between the poles followed by the two pole rows.
+// a row holds the left channel followed by the right channel, each being numTimeSteps taps, or numComponents weights of the basis vectors for compressed tables.
+// distance factorized tables (numCorrectionTaps > 0) only have the rows of the farthest distance, followed by the correction rows for every distance,
+// each holding the left and right channel's short filter (numCorrectionTaps taps) that turns the far field hrir of that row into the one at that distance.
+// the file ends with the L1 norms of the left and right channel of every row at every distance (of the hrirs the compressed or distance factorized rows stand for).
+static constexpr std::size_t HRIRTableFileAlignment = 64; // bytes
+static constexpr int HRIRTableFileMaxCorrectionTaps = 16;
+
+struct HRIRTableFileHeader
+{
+    char magic[8] = {'3','D','A','H','R','I','R','T'};
+    // the size (in bytes) and modification time (in milliseconds since 1970) of the 3DAudioData.bin that a cached table was converted or resampled from, so that it is only used with that data file, both 0 for tables that are not checked against it
+    std::int64_t sourceSize = 0;
+    std::int64_t sourceModificationTime = 0;
+    std::int32_t version = 6;
+    std::int32_t byteOrder = 0x01020304; // files are written in native byte order
+    std::int32_t numDistances = numDistanceSteps;
+    std::int32_t numAzimuths = numAzimuthSteps/2 + 1;
+    std::int32_t numElevations = numElevationSteps;
+    std::int32_t numTimes = numTimeSteps;
+    std::int32_t rowsPerDistance = (numAzimuthSteps/2 + 1) * (numElevationSteps - 1) + 2;
+    std::int32_t sizeOfFloat = sizeof(float);
+    std::int32_t numComponents = 0; // 0 for the raw hrirs
+    std::int32_t numCorrectionTaps = 0; // 0 for rows at every distance
+    std::int32_t sampleRate = std::int32_t(sampleRate_HRTF); // of the hrirs, which are resampled from the data's own rate for hosts running at other rates
+    char padding[2*HRIRTableFileAlignment - 8 - 2*sizeof(std::int64_t) - 11*sizeof(std::int32_t)] = {};
+    
+    // the number of floats after the header
+    std::size_t getDataSize() const noexcept
+    {
+        const std::size_t channelSize = numComponents > 0 ? numComponents : numTimes;
+        const std::size_t rowsSize = std::size_t(rowsPerDistance) * 2 * channelSize;
+        if (numCorrectionTaps > 0)
+            return std::size_t(numComponents) * numTimes + rowsSize + std::size_t(numDistances) * rowsPerDistance * 2 * numCorrectionTaps + getNumNorms();
+        return std::size_t(numComponents) * numTimes + numDistances * rowsSize + getNumNorms();
+    }
+    // the number of floats of norms at the end of the file
+    std::size_t getNumNorms() const noexcept
+    {
+        return std::size_t(numDistances) * rowsPerDistance * 2;
+    }
+};
+static_assert(sizeof(HRIRTableFileHeader) == 2*HRIRTableFileAlignment, "the table must start aligned in the file");
+
+#endif /* HRIRTableFile_h */
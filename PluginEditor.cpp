@@ -110,6 +110,30 @@ ThreeDAudioProcessorEditor::ThreeDAudioProcessorEditor (ThreeDAudioProcessor* ow
     processingModeHelpLook.just = Justification::topLeft;
     processingModeHelp.setLook(&processingModeHelpLook);
     
+    // the audio engine settings look like the processing mode, with their titles in white
+    settingsNormalLook = processingModeNormalLook;
+    settingsSelectedLook = processingModeSelectedLook;
+    settingsSelectAnimationBeginLook = processingModeSelectAnimationBeginLook;
+    settingsMouseOverLook = processingModeMouseOverLook;
+    settingsTitleLook = processingModeNormalLook;
+    settingsTitleLook.color = Colours::white;
+    addSettingsRow("Convolution:", {"TimeDomain", "PartitionedFFT"}, convolutionEngineHelpText,
+                   [this] { return (int)processor->convolutionEngine.load(); },
+                   [this] (const int i) { processor->convolutionEngine = (ConvolutionEngine)i; });
+    addSettingsRow("Doppler:", {"Scatter", "FractionalDelay"}, dopplerEngineHelpText,
+                   [this] { return (int)processor->dopplerEngine.load(); },
+                   [this] (const int i) { processor->dopplerEngine = (DopplerEngine)i; });
+    addSettingsRow("Doppler Ears:", {"Stereo", "Mono"}, monoDopplerHelpText,
+                   [this] { return processor->monoDoppler.load() ? 1 : 0; },
+                   [this] (const int i) { processor->monoDoppler = i == 1; },
+                   [this] { return processor->dopplerEngine.load() == DopplerEngine::FRACTIONAL_DELAY; });
+    addSettingsRow("Resampling:", {"Low", "Medium", "High"}, resamplingQualityHelpText,
+                   [this] { return processor->resamplingQuality == ResamplingQuality::LOW ? 0 : processor->resamplingQuality == ResamplingQuality::MEDIUM ? 1 : 2; },
+                   [this] (const int i) { processor->setResamplingQuality(i == 0 ? ResamplingQuality::LOW : i == 1 ? ResamplingQuality::MEDIUM : ResamplingQuality::HIGH); });
+    addSettingsRow("Block Size:", {"Host", "32", "64", "128", "256"}, internalBlockSizeHelpText,
+                   [this] { cauto size = processor->internalBlockSize.load(); return size <= 0 ? 0 : size <= 32 ? 1 : size <= 64 ? 2 : size <= 128 ? 3 : 4; },
+                   [this] (const int i) { processor->setInternalBlockSize(i == 0 ? 0 : 16 << i); });
+    
     tabs.setSelected(static_cast<int>(processor->displayState.load()), false);
     loadHelpText();
     
@@ -449,6 +473,30 @@ void ThreeDAudioProcessorEditor::drawHelp()
     helpButton.draw(glWindow, {getMouseX(), getMouseY()});
 }
 
+void ThreeDAudioProcessorEditor::drawHRIRLoadProgress() const
+{
+    cauto progress = processor->getHRIRLoadProgress();
+    if (progress >= 1)
+        return;
+    // thin bar along the bottom of the window that fills up as the data loads
+    cauto h = pixelsToNormalized(4, glWindow.height);
+    cauto x = -1 + 2*progress;
+    glColor4f(1, 1, 1, 0.2f);
+    glBegin(GL_QUADS);
+    glVertex2f(-1.0, -1.0 + h);
+    glVertex2f( 1.0, -1.0 + h);
+    glVertex2f( 1.0, -1.0);
+    glVertex2f(-1.0, -1.0);
+    glEnd();
+    glColor4f(1, 1, 1, 0.8f);
+    glBegin(GL_QUADS);
+    glVertex2f(-1.0, -1.0 + h);
+    glVertex2f(   x, -1.0 + h);
+    glVertex2f(   x, -1.0);
+    glVertex2f(-1.0, -1.0);
+    glEnd();
+}
+
 void ThreeDAudioProcessorEditor::loadHelpText()
 {
     //const Array<String> * whichText = nullptr;
@@ -479,6 +527,24 @@ void ThreeDAudioProcessorEditor::loadHelpText()
 //    }
 }
 
+void ThreeDAudioProcessorEditor::addSettingsRow(const std::string& title,
+                                                const std::vector<std::string>& options,
+                                                const std::string& helpText,
+                                                std::function<int()> getSelected,
+                                                std::function<void(int)> setSelected,
+                                                std::function<bool()> isEnabled)
+{
+    // boundaries are set in resized()
+    GLTitledRadioButton button {TextBox(title, Box(), &settingsTitleLook),
+                                GLTextRadioButton({options, 1, Box(), &settingsNormalLook, true})};
+    button.setNormalLook(&settingsNormalLook);
+    button.setSelectedLook(&settingsSelectedLook, &settingsSelectAnimationBeginLook);
+    button.setMouseOverLook(&settingsMouseOverLook);
+    button.setMouseOverAutoDetectLook(&settingsMouseOverLook);
+    button.setSelected(getSelected(), false);
+    settingsRows.push_back({button, &helpText, std::move(getSelected), std::move(setSelected), std::move(isEnabled)});
+}
+
 void ThreeDAudioProcessorEditor::newOpenGLContextCreated()
 {
     /** This method is called when the component creates a new OpenGL context.
@@ -2613,6 +2679,24 @@ void ThreeDAudioProcessorEditor::myResized()
     auto right = len * 0.5f;
     processingModeOptions.setBoundary({top, bottom, left, right});
     
+    // the settings rows, each centered with its title to the left of its options
+    cauto settingsFontSize = 20*displayScale;
+    settingsTitleLook.fontSize = settingsFontSize;
+    for (auto& row : settingsRows) {
+        row.options.setFontSize(settingsFontSize);
+        row.options.title.setLook(&settingsTitleLook);
+        float optionsLen = 0;
+        for (const auto& b : row.options.getTextBoxes())
+            optionsLen += pixelsToNormalized(b.getTextLength(getWidth(), getHeight()), getWidth()*displayScale);
+        optionsLen /= settingsNormalLook.horizontalPad;
+        cauto titleLen = pixelsToNormalized(row.options.title.getTextLength(getWidth(), getHeight()), getWidth()*displayScale) / settingsTitleLook.horizontalPad;
+        top = bottom - pixelsToNormalized(8, getHeight());
+        bottom = top - pixelsToNormalized(settingsFontSize / settingsNormalLook.verticalPad, getHeight()*displayScale);
+        left = -(titleLen + optionsLen) * 0.5f;
+        row.options.title.setBoundary({top, bottom, left, left + titleLen});
+        row.options.setBoundary({top, bottom, left + titleLen, left + titleLen + optionsLen});
+    }
+    
     processingModeHelpLook.fontSize = 18*displayScale;
     processingModeHelp.setLook(&processingModeHelpLook);
     top = bottom - pixelsToNormalized(10, getHeight());
@@ -2795,14 +2879,30 @@ void ThreeDAudioProcessorEditor::renderOpenGL()
                 glColor4f(1, 1, 1, 0.4f);
                 if (processingModeOptions.autoDetectSelected())
                     processingModeOptions.getTextBoxes()[processingModeOptions.getAutoDetected()].getBoundary().drawOutline();
-                int newProcessingModeHelpIndex = 0;
-                if (processingModeOptions.getMouseOver() >= 0)
-                    newProcessingModeHelpIndex = processingModeOptions.getMouseOver();
-                else
-                    newProcessingModeHelpIndex = processingModeOptions.getSelected();
-                if (newProcessingModeHelpIndex != currentProcessingModeHelpIndex) {
-                    currentProcessingModeHelpIndex = newProcessingModeHelpIndex;
-                    processingModeHelp.setText(processingModeHelpText[currentProcessingModeHelpIndex]);
+                const std::string* newSettingsHelpText = nullptr;
+                for (auto& row : settingsRows) {
+                    // a disabled row is drawn darkened and never has the mouse over it
+                    const bool enabled = !row.isEnabled || row.isEnabled();
+                    row.options.setSelected(row.getSelected(), false);
+                    row.options.draw(glWindow, enabled ? mousePos : Point<float>(-10, -10));
+                    glColor3f(1, 1, 1);
+                    row.options.getTextBoxes()[row.options.getSelected()].getBoundary().drawOutline();
+                    if (!enabled) {
+                        glColor4f(0, 0, 0, 0.6f);
+                        row.options.title.getBoundary().combinedWith(row.options.getBoundary()).drawFill();
+                    }
+                    if (row.options.getMouseOver() >= 0 || (enabled && row.options.title.getBoundary().contains(mousePos)))
+                        newSettingsHelpText = row.helpText;
+                }
+                if (newSettingsHelpText == nullptr) {
+                    if (processingModeOptions.getMouseOver() >= 0)
+                        newSettingsHelpText = &processingModeHelpText[processingModeOptions.getMouseOver()];
+                    else
+                        newSettingsHelpText = &processingModeHelpText[processingModeOptions.getSelected()];
+                }
+                if (newSettingsHelpText != currentSettingsHelpText) {
+                    currentSettingsHelpText = newSettingsHelpText;
+                    processingModeHelp.setText(*currentSettingsHelpText);
                 }
                 processingModeHelp.draw(glWindow);
 
@@ -2835,6 +2935,7 @@ void ThreeDAudioProcessorEditor::renderOpenGL()
 
         tabs.mouseOverEnabled = !selectionBox.isActive()/*mouseDragging*/ && !loopRegionBeginSelected && !loopRegionEndSelected && !pathAutomationPointsGrabbedWithMouse;
         tabs.draw(glWindow, mousePos);
+        drawHRIRLoadProgress();
 
         if (processor->displayState != DisplayState::SETTINGS) {
             cauto mouseOverEnabled =
@@ -2925,6 +3026,8 @@ void ThreeDAudioProcessorEditor::timerCallback(const int timerID)
     switch (timerID) {
         case 0: // tell the gl to repaint the scene on the interval that timer0 is set to
             if (processor != nullptr) {
+                // show the sources where the audio thread moved them along their paths
+                processor->sources.applyPositionUpdates();
                 openGLContext.triggerRepaint();
             }
             //repaint(); to call JUCE Component::paint()
@@ -3614,7 +3717,18 @@ void ThreeDAudioProcessorEditor::mouseUp(const MouseEvent & event)
                 if (selectedMode >= 0) {
                     processor->setProcessingMode((ProcessingMode)selectedMode);
                     processingModeOptions.setAutoDetected(processor->isHostRealTime ? 0 : 1);
-                } else if (websiteButton.mouseClicked()) {
+                    break;
+                }
+                bool settingClicked = false;
+                for (auto& row : settingsRows) {
+                    // the mouse is never over a disabled row's options, see draw
+                    const int selected = row.options.mouseClicked();
+                    if (selected >= 0) {
+                        row.setSelected(selected);
+                        settingClicked = true;
+                    }
+                }
+                if (!settingClicked && websiteButton.mouseClicked()) {
                     const URL url ("http://www.freedomaudioplugins.com");
                     url.launchInDefaultBrowser();
                 }
@@ -167,6 +167,8 @@ public:
     // Draw scene in here
     void renderOpenGL() override;
     void drawHelp();
+    // shows how much of the hrir data is loaded while it loads in the background
+    void drawHRIRLoadProgress() const;
     void loadHelpText();
     void drawHead() const;
     // main view for drawing a path
@@ -350,7 +352,25 @@ private:
     TextLook processingModeHelpLook;
     TextBox processingModeHelp {"", {0.65f, websiteButton.getBoundary().getTop(), -0.85f, 0.85f}, &processingModeHelpLook};
     //MultiLineTextBox processingModeHelp {"", {0.65, 0, -0.85, 0.85}};
-    int currentProcessingModeHelpIndex = -1;
+    // the help text shown, for the processing mode or the settings row the mouse is over
+    const std::string* currentSettingsHelpText = nullptr;
+    // the audio engine settings listed below the processing mode, each a title followed by one option per value of the setting, and the help text shown while the mouse is over it
+    struct SettingsRow
+    {
+        GLTitledRadioButton options;
+        const std::string* helpText;
+        std::function<int()> getSelected;
+        std::function<void(int)> setSelected;
+        std::function<bool()> isEnabled; // always enabled if empty
+    };
+    void addSettingsRow(const std::string& title, const std::vector<std::string>& options, const std::string& helpText,
+                        std::function<int()> getSelected, std::function<void(int)> setSelected, std::function<bool()> isEnabled = nullptr);
+    TextLook settingsTitleLook;
+    TextLook settingsNormalLook;
+    TextLook settingsSelectedLook;
+    TextLook settingsSelectAnimationBeginLook;
+    TextLook settingsMouseOverLook;
+    std::vector<SettingsRow> settingsRows;
     // *** stuff that the plugin instance should own ***
     // eye position
     float upDir = 1;  // y component of eyeUp
@@ -590,6 +610,21 @@ static const std::vector<std::string> automationHelp =
     "'h' to toggle help"
 };
 
+static const std::string convolutionEngineHelpText
+    {"    How each sound source's input is convolved with its hrirs, both give the same output.  TimeDomain computes each output sample directly and costs the least at buffer sizes up to a few hundred samples.  PartitionedFFT multiplies the spectra of 64 sample blocks of the input and of the hrirs, which can cost less for large buffers."};
+
+static const std::string dopplerEngineHelpText
+    {"    How the doppler effect is computed for moving sound sources when it is turned on.  Scatter spreads each sample of a source's output over the time it arrives at the listener, its CPU demand grows with how fast the source moves.  FractionalDelay reads each source's input at its delay from one delay line shared by all of the sound sources, which costs the same however fast the sources move and makes the mono doppler option available.  Sessions saved before this setting existed use scatter."};
+
+static const std::string monoDopplerHelpText
+    {"    With the fractional delay doppler engine, Stereo delays the input to each ear by that ear's distance from the sound source, and Mono delays the input to both ears by the source's distance from the center of the head, so each moving sound source computes one delayed input instead of two and both ears convolve the same one.  It is not available with the scatter doppler engine."};
+
+static const std::string resamplingQualityHelpText
+    {"    How many samples of the input each output sample is filtered from when the audio is converted to and from the sample rate of the hrir data, which is done at host sample rates above 48 kHz.  Low costs the least CPU and High passes the most of the high frequencies with the least aliasing.  Medium is a good balance of the two."};
+
+static const std::string internalBlockSizeHelpText
+    {"    How many samples the sound sources are processed in at a time.  Host processes them in the buffers your DAW gives this plugin, which adds no latency, but the sources' positions are updated and their CPU demand is spread out at whatever rate those buffers come.  A fixed size processes them the same way whatever your DAW's buffer size, and delays the output by that many samples unless your DAW's buffers are already that size.  64 is a good size."};
+
 static const std::array<std::string, 3> processingModeHelpText
     {"    The realtime processing mode is intended to be used when you are editing the tracks that use this plugin.  It puts the least strain on your CPU so that you can listen to your tracks in realtime while you edit them.  However, for moving sound sources, the audio quality will be less than ideal so don't use this setting when you are doing the final export of your tracks that have moving sound sources.",
      "    The high quality processing mode is intended to be used when you are done editing your tracks that use this plugin and want the highest audio quality possible for moving sound sources.  When using this processing mode, high demand is placed on your CPU so you may not be able to listen to your tracks in realtime.  Select this mode before you lock any tracks that you are done editing or before you do the final export of your tracks to get the highest possible audio quality for your moving sound sources.",
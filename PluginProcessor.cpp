@@ -22,7 +22,6 @@
 
 #include "PluginEditor.h"
 #include "Data.h"
-#include <fstream>
 
 #ifdef DEMO // Demo version only
 class BuyMeWindowContents : public Component, public TextButton::Listener
@@ -67,168 +66,143 @@ void ThreeDAudioProcessor::timerCallback()
 }
 #endif
 
-// the global hrir data that gets one instance across multiple plugin instances
-float***** HRIRdata;
-float****  HRIRdataPoles;
+void SourcesResource::load(const Sources& resource)
+{
+    RealtimeConcurrent<Sources, 3>::load(resource);
+    {
+        // the new sources replace wherever the old ones were moved to
+        const std::lock_guard<std::mutex> lock (takeLock);
+        for (std::size_t c = 0; c < numCopies; ++c)
+            for (int s = 0; s < maxNumSources; ++s)
+                takenSequences[c][s] = positionUpdates[s].sequence.load(std::memory_order_acquire);
+    }
+    snapshots.publish(resource);
+}
+
+void SourcesResource::update(Sources* updatedCopy)
+{
+    {
+        const std::lock_guard<std::mutex> lock (takeLock);
+        // the sources moved along their paths would jump back to where the copy has them otherwise
+        const std::size_t copyIndex = indexOf(updatedCopy);
+        if (copyIndex < numCopies)
+            takePositionUpdates(*updatedCopy, copyIndex);
+        RealtimeConcurrent<Sources, 3>::update(updatedCopy);
+        if (copyIndex < numCopies)
+            allCopiesTook(copyIndex);
+    }
+    snapshots.publish(*updatedCopy);
+}
+
+void SourcesResource::update(const Sources* updatedCopy)
+{
+    {
+        const std::lock_guard<std::mutex> lock (takeLock);
+        // the updated sources (from an undo or redo) replace wherever the sources were moved to
+        std::array<std::uint32_t, maxNumSources> sequences;
+        for (int s = 0; s < maxNumSources; ++s)
+            sequences[s] = positionUpdates[s].sequence.load(std::memory_order_acquire);
+        RealtimeConcurrent<Sources, 3>::update(updatedCopy);
+        for (auto& taken : takenSequences)
+            taken = sequences;
+    }
+    snapshots.publish(*updatedCopy);
+}
+
+void SourcesResource::applyPositionUpdates()
+{
+    {
+        // skipped while an update() (which takes the position updates too) is waiting on a copy that the calling thread may have locked.
+        // a copy locked by another thread (like the one the gl is drawing) gets the updates it missed at a later call
+        const std::unique_lock<std::mutex> lock (takeLock, std::try_to_lock);
+        if (lock.owns_lock())
+            tryToApply([this] (Sources& copy, const std::size_t copyIndex) { takePositionUpdates(copy, copyIndex); });
+    }
+    snapshots.reclaim();
+}
+
+void SourcesResource::setPositionUpdate(const int sourceIndex, const std::array<float, 3>& posRAE, const bool muted, const int numSources) noexcept
+{
+    // the audio thread is the only writer, the sequence is odd while it writes so that a reader can tell it got a torn update and try again
+    auto& u = positionUpdates[sourceIndex];
+    const std::uint32_t sequence = u.sequence.load(std::memory_order_relaxed);
+    u.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (int i = 0; i < 3; ++i)
+        u.posRAE[i].store(posRAE[i], std::memory_order_relaxed);
+    u.muted.store(muted, std::memory_order_relaxed);
+    u.numSources.store(numSources, std::memory_order_relaxed);
+    u.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+void SourcesResource::takePositionUpdates(Sources& copy, const std::size_t copyIndex)
+{
+    for (int s = 0; s < std::min((int)copy.size(), maxNumSources); ++s) {
+        auto& u = positionUpdates[s];
+        std::uint32_t sequence;
+        std::array<float, 3> posRAE;
+        bool muted;
+        int numSources;
+        do {
+            sequence = u.sequence.load(std::memory_order_acquire);
+            for (int i = 0; i < 3; ++i)
+                posRAE[i] = u.posRAE[i].load(std::memory_order_relaxed);
+            muted = u.muted.load(std::memory_order_relaxed);
+            numSources = u.numSources.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while ((sequence & 1) || sequence != u.sequence.load(std::memory_order_relaxed));
+        if (sequence == takenSequences[copyIndex][s])
+            continue;
+        takenSequences[copyIndex][s] = sequence;
+        // only a source on a path is moved by the audio thread, so a source edited off of its path (or one that moved to this index) keeps its position
+        if (numSources == (int)copy.size() && copy[s].getNumPathPoints() > 1)
+            copy[s].setPositionUpdate(posRAE, muted);
+    }
+}
+
+void SourcesResource::allCopiesTook(const std::size_t copyIndex) noexcept
+{
+    for (auto& taken : takenSequences)
+        taken = takenSequences[copyIndex];
+}
+
+float ThreeDAudioProcessor::getHRIRLoadProgress() const noexcept
+{
+    return std::atomic_load(&HRIRdata)->getProgress();
+}
+
+void ThreeDAudioProcessor::setHRIRdata(std::shared_ptr<const HRIRTableLoader> newHRIRdata) noexcept
+{
+    // only called when the audio thread is not processing (the constructor and prepareToPlay()), so the loader it points to outlives its use there
+    audioHRIRdata = newHRIRdata.get();
+    std::atomic_store(&HRIRdata, std::move(newHRIRdata));
+}
 
 //==============================================================================
 ThreeDAudioProcessor::ThreeDAudioProcessor()
 {
-	// if there are no instances going, load the global hrir data for all possible future instances
-	if (numRefs == 0) {
-		// unified poles, compact data
-		// binary hrtf file name
-		String path;
+	// get the hrir data shared by all plugin instances, which is loaded if there are no instances going (or it has not been kept around from the last one)
+	// unified poles, compact data
+	// binary hrtf file name
+	String path;
 #ifdef __APPLE__
-        path = File::getSpecialLocation(File::currentApplicationFile).getFullPathName();
-        path += "/Contents/3DAudioData.bin";
+    path = File::getSpecialLocation(File::currentApplicationFile).getFullPathName();
+    path += "/Contents/3DAudioData.bin";
 #elif _WIN32
-		path = File::getSpecialLocation(File::currentApplicationFile).getParentDirectory().getFullPathName();
-		path += "/3DAudioData.bin";
+	path = File::getSpecialLocation(File::currentApplicationFile).getParentDirectory().getFullPathName();
+	path += "/3DAudioData.bin";
 #endif
-		// basic read (should be cross platform)
-		// open the stream
-		std::ifstream is(path.getCharPointer(), std::ios::binary);
-		if (is.good()) {
-			HRIRdata = new float****[numDistanceSteps];
-			for (int d = 0; d < numDistanceSteps; ++d) {
-				HRIRdata[d] = new float***[numAzimuthSteps / 2 + 1];
-				for (int a = 0; a < numAzimuthSteps / 2 + 1; ++a) {
-					HRIRdata[d][a] = new float**[numElevationSteps - 1];
-					for (int e = 0; e < numElevationSteps - 1; ++e) {
-						HRIRdata[d][a][e] = new float*[2];
-						for (int ch = 0; ch < 2; ++ch) {
-							HRIRdata[d][a][e][ch] = new float[numTimeSteps];
-							is.read((char*)HRIRdata[d][a][e][ch], numTimeSteps * sizeof(float));
-						}
-					}
-				}
-			}
-			// pole data is the same for both channels
-			HRIRdataPoles = new float***[numDistanceSteps];
-			std::array<float, numTimeSteps> poleDataBuffer;
-			for (int d = 0; d < numDistanceSteps; ++d) {
-				HRIRdataPoles[d] = new float**[2];
-				HRIRdataPoles[d][0] = new float*[2]; // ele = 0 pole
-				HRIRdataPoles[d][1] = new float*[2]; // ele = 180 pole
-				HRIRdataPoles[d][0][0] = new float[numTimeSteps];
-				HRIRdataPoles[d][0][1] = new float[numTimeSteps];
-				is.read((char*)&poleDataBuffer[0], numTimeSteps * sizeof(float));
-				for (int t = 0; t < numTimeSteps; ++t)
-					HRIRdataPoles[d][0][1][t] = HRIRdataPoles[d][0][0][t] = poleDataBuffer[t];
-				HRIRdataPoles[d][1][0] = new float[numTimeSteps];
-				HRIRdataPoles[d][1][1] = new float[numTimeSteps];
-				is.read((char*)&poleDataBuffer[0], numTimeSteps * sizeof(float));
-				for (int t = 0; t < numTimeSteps; ++t)
-					HRIRdataPoles[d][1][1][t] = HRIRdataPoles[d][1][0][t] = poleDataBuffer[t];
-			}
-			is.close();
-		}
-	//// MAC ONLY
- //   // if there are no instances going, load the global hrir data for all possible future instances
- //   if (numRefs == 0) {
- //       // unified poles, compact data
- //       // binary hrtf file name
- //       String path = File::getSpecialLocation(File::currentApplicationFile).getParentDirectory().getFullPathName();
- //       path += "/3dAudioData.bin"; // the compact, unified poles data that is
- //       // basic read (should be cross platform)
- //       // open the stream
- //       std::ifstream is(path.getCharPointer());
- //       if (is.good()) {
- //           // determine the file length
- //           is.seekg(0, is.end);
- //           size_t size = is.tellg();
- //           is.seekg(0, is.beg);
- //           // create a temp array to store the data
- //           char* dataBuffer = new char[size];
- //           // load the data
- //           is.read(dataBuffer, size);
- //           // close the file
- //           is.close();
- //           // pack data into HRIR array
- //           int index = 0;
- //           HRIRdata = new float****[numDistanceSteps];
- //           for (int d = 0; d < numDistanceSteps; ++d) {
- //               HRIRdata[d] = new float***[numAzimuthSteps/2+1];
- //               for (int a = 0; a < numAzimuthSteps/2+1; ++a) {
- //                   HRIRdata[d][a] = new float**[numElevationSteps-1];
- //                   for (int e = 0; e < numElevationSteps-1; ++e) {
- //                       HRIRdata[d][a][e] = new float*[2];
- //                       for (int ch = 0; ch < 2; ++ch) {
- //                           HRIRdata[d][a][e][ch] = new float[numTimeSteps];
- //                           for (int t = 0; t < numTimeSteps; ++t) {
- //                               HRIRdata[d][a][e][ch][t] = *((float*) &dataBuffer[index*sizeof(float)]);
- //                               ++index;
- //                           }
- //                       }
- //                   }
- //               }
- //           }
- //           // pole data is the same for both channels
- //           HRIRdataPoles = new float***[numDistanceSteps];
- //           for (int d = 0; d < numDistanceSteps; ++d) {
- //               HRIRdataPoles[d] = new float**[2];
- //               HRIRdataPoles[d][0] = new float*[2]; // ele = 0 pole
- //               HRIRdataPoles[d][1] = new float*[2]; // ele = 180 pole
- //               HRIRdataPoles[d][0][0] = new float[numTimeSteps];
- //               HRIRdataPoles[d][0][1] = new float[numTimeSteps];
- //               for (int t = 0; t < numTimeSteps; ++t) {
- //                   HRIRdataPoles[d][0][1][t] = HRIRdataPoles[d][0][0][t] = *((float*) &dataBuffer[index*sizeof(float)]);
- //                   ++index;
- //               }
- //               HRIRdataPoles[d][1][0] = new float[numTimeSteps];
- //               HRIRdataPoles[d][1][1] = new float[numTimeSteps];
- //               for (int t = 0; t < numTimeSteps; ++t) {
- //                   HRIRdataPoles[d][1][1][t] = HRIRdataPoles[d][1][0][t] = *((float*) &dataBuffer[index*sizeof(float)]);
- //                   ++index;
- //               }
- //           }
- //           // cleanup the temp array
- //           delete[] dataBuffer;
- //       } 
-		else {
-            // failed to open hrtf binary file, load up zeros
-            HRIRdata = new float****[numDistanceSteps];
-            for (int d = 0; d < numDistanceSteps; ++d) {
-                HRIRdata[d] = new float***[numAzimuthSteps];
-                for (int a = 0; a < numAzimuthSteps; ++a) {
-                    HRIRdata[d][a] = new float**[numElevationSteps];
-                    for (int e = 0; e < numElevationSteps; ++e) {
-                        HRIRdata[d][a][e] = new float*[2];
-                        for (int ch = 0; ch < 2; ++ch) {
-                            HRIRdata[d][a][e][ch] = new float[numTimeSteps];
-                            for (int t = 0; t < numTimeSteps; ++t) {
-                                HRIRdata[d][a][e][ch][t] = 0;
-                            }
-                        }
-                    }
-                }
-            }
-            // pole data is the same for both channels
-            HRIRdataPoles = new float***[numDistanceSteps];
-            for (int d = 0; d < numDistanceSteps; ++d) {
-                HRIRdataPoles[d] = new float**[2];
-                HRIRdataPoles[d][0] = new float*[2]; // ele = 0 pole
-                HRIRdataPoles[d][0][0] = new float[numTimeSteps];
-                HRIRdataPoles[d][0][1] = new float[numTimeSteps];
-                HRIRdataPoles[d][1] = new float*[2]; // ele = 180 pole
-                HRIRdataPoles[d][1][0] = new float[numTimeSteps];
-                HRIRdataPoles[d][1][1] = new float[numTimeSteps];
-                for (int t = 0; t < numTimeSteps; ++t) {
-                    HRIRdataPoles[d][0][0][t] = 0;
-                    HRIRdataPoles[d][0][1][t] = 0;
-                    HRIRdataPoles[d][1][0][t] = 0;
-                    HRIRdataPoles[d][1][1][t] = 0;
-                }
-            }
-        }
-    }
+	// the hrir table is memory mapped read only from a file in the in memory layout, so it loads near instantly and its pages are shared by every process hosting the plugin.
+	// that file can ship next to 3DAudioData.bin, otherwise it is converted from 3DAudioData.bin once and kept in the user's application data folder.
+	// either way it is loaded on a background thread, processBlock() outputs no wet signal until it is ready.
+	// prepareToPlay() swaps it for the data resampled to the host's rate (which is cached next to the converted file) if the sources are processed at that rate.
+	HRIRDataFile = File(path);
+	HRIRCacheFile = File::getSpecialLocation(File::userApplicationDataDirectory).getChildFile("3DAudio").getChildFile("3DAudioData.hrir");
+	setHRIRdata(HRIRStore::acquire(HRIRDataFile, HRIRCacheFile));
 
-    // increment plugin reference count
-    ++numRefs;
-    
     // pre-allocate space for maximum number of playableSources, so we don't have to in processBlock()
     playableSources.resize(maxNumSources);
+    stationarySources.allocate(maxNumSources);
     
     // load up one source as the default
     sources.load(std::vector<SoundSource>(1));
@@ -262,38 +236,8 @@ ThreeDAudioProcessor::~ThreeDAudioProcessor()
   
     // cleanup memeory for undo's
     clearUndoHistory();
-
-    // cleanup hrir data if we are closing the only plugin instance
-    if (numRefs == 1) {
-        for (int d = numDistanceSteps-1; d >= 0; --d) {
-            //for (int a = numAzimuthSteps-1; a >= 0; --a) {
-            for (int a = numAzimuthSteps/2; a >= 0; --a) {
-                //for (int e = numElevationSteps-1; e >= 0; --e) {
-                for (int e = numElevationSteps-2; e >= 0; --e) {
-                    for (int ch = 1; ch >= 0; --ch) {
-                        delete[] HRIRdata[d][a][e][ch];
-                    }
-                    delete[] HRIRdata[d][a][e];
-                }
-                delete[] HRIRdata[d][a];
-            }
-            delete[] HRIRdata[d];
-        }
-        delete[] HRIRdata;
-        for (int d = numDistanceSteps-1; d >= 0; --d) {
-            for (int e = 1; e >= 0; --e) {
-                for (int ch = 1; ch >= 0; --ch) {
-                    delete[] HRIRdataPoles[d][e][ch];
-                }
-                delete[] HRIRdataPoles[d][e];
-            }
-            delete[] HRIRdataPoles[d];
-        }
-        delete[] HRIRdataPoles;
-    }
     
-    // decrement plugin reference count
-    --numRefs;
+    // the hrir data is released when HRIRdata goes, and is freed by the HRIRStore a while later, or when hrirStoreUser goes if this is the last instance
 }
 
 // saves the current sources state beforeOrAfter == -1 -> before edit w/ reset,
@@ -1332,6 +1276,30 @@ void ThreeDAudioProcessor::setProcessingMode(const ProcessingMode newMode) noexc
         realTime = (processingMode == ProcessingMode::REALTIME);
 }
 
+void ThreeDAudioProcessor::setResamplingQuality(const ResamplingQuality newQuality)
+{
+    resamplingQuality = newQuality;
+    reprepare();
+}
+
+void ThreeDAudioProcessor::setInternalBlockSize(const int newInternalBlockSize)
+{
+    internalBlockSize = std::max(0, newInternalBlockSize);
+    reprepare();
+}
+
+// applies the settings that take effect at prepareToPlay() right away, if the host has already prepared the plugin
+void ThreeDAudioProcessor::reprepare()
+{
+    if (getSampleRate() <= 0 || getBlockSize() <= 0)
+        return;
+    const bool wasSuspended = isSuspended();
+    suspendProcessing(true);
+    prepareToPlay(getSampleRate(), getBlockSize());
+    if (!wasSuspended)
+        suspendProcessing(false);
+}
+
 std::string ThreeDAudioProcessor::getCurrentTimeString(const int opt) const
 {
     switch (opt)
@@ -1434,10 +1402,10 @@ bool ThreeDAudioProcessor::silenceInProducesSilenceOut() const
 double ThreeDAudioProcessor::getTailLengthSeconds() const
 {
     // not sure if the tail length reported here should include latency due to resampling
-    if (fs != sampleRate_HRTF) {
-        return (numTimeSteps+1.0) / getSampleRate();
+    if (fs != processingRate) {
+        return numTimeSteps / sampleRate_HRTF + resampler.getLatency() + unsamplerCh1.getLatency() + preparedBlockSize / getSampleRate();
     } else {
-        return numTimeSteps / getSampleRate();
+        return (numTimeSteps + preparedBlockSize) / getSampleRate();
     }
 }
 
@@ -1469,20 +1437,41 @@ void ThreeDAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock
     // Use this method as the place to do any pre-playback
     // initialisation that you need..
     N = samplesPerBlock;
-    if (fs != sampleRate) {
-        fs = sampleRate;
+    fs = sampleRate;
+    // the sources are processed at the host's rate with the hrir data resampled to it when possible, otherwise the audio is resampled to the hrir data's rate and back
+    const float newProcessingRate = (nativeRateHRIRs && fs <= maxNativeHRIRSampleRate) ? fs.load() : sampleRate_HRTF;
+    if (processingRate != newProcessingRate) {
+        processingRate = newProcessingRate;
         // set doppler(s) to the new sample rate, reallocation for this change happens in allocateForMaxBufferSize() below
         for (auto& s : playableSources)
-            s.setDopplerSampleRate(sampleRate_HRTF/*fs*/); // doppler processing is done @ sample rate of hrtf data
+            s.setDopplerSampleRate(processingRate); // doppler processing is done @ sample rate of hrtf data
+        sourceInput.setDopplerSampleRate(processingRate);
         // TODO: detect largest latency of doppler and factor that in to the setLatencySamples() call below
     }
-	maxBufferSizePreparedFor = N;
-    if (fs != sampleRate_HRTF) {
-        resampler = Resampler(fs, N, sampleRate_HRTF, true);
-        unsamplerCh1 = Resampler(sampleRate_HRTF, N, fs, false);
-        unsamplerCh2 = Resampler(sampleRate_HRTF, N, fs, false);
-        setLatencySamples(1);
-		maxBufferSizePreparedFor = std::max(resampler.getNoutMax(), N.load());
+    const int hrirSampleRate = int(std::lround(processingRate));
+    if (std::atomic_load(&HRIRdata)->getSampleRate() != hrirSampleRate)
+        setHRIRdata(HRIRStore::acquire(HRIRDataFile, HRIRCacheFile, hrirSampleRate));
+    // the sources are processed in blocks of a fixed size, which are gathered from the host's buffers a block ahead of the output, or else in the host's buffers.
+    // when the host's buffers are already that size they are processed as they come, without the added latency of gathering them
+    preparedBlockSize = std::max(0, internalBlockSize.load());
+    if (preparedBlockSize == samplesPerBlock)
+        preparedBlockSize = 0;
+    const int blockN = preparedBlockSize > 0 ? preparedBlockSize : N.load();
+    hostBlockSizePreparedFor = std::max(1, blockN);
+    blockInput.assign(3 * preparedBlockSize, 0.0f);
+    blockOutput.assign(4 * preparedBlockSize, 0.0f);
+    blockFill = 0;
+    resetBlockProcessingState = false;
+	maxBufferSizePreparedFor = blockN;
+    if (fs != processingRate) {
+        // the resamplers take buffers of any size, but are set up for blockN to have their fifos big enough to not split up buffers
+        resampler = PolyphaseResampler(fs, sampleRate_HRTF, blockN, resamplingQuality);
+        unsamplerCh1 = PolyphaseResampler(sampleRate_HRTF, fs, resampler.getNoutMax(blockN), resamplingQuality);
+        unsamplerCh2 = PolyphaseResampler(sampleRate_HRTF, fs, resampler.getNoutMax(blockN), resamplingQuality);
+        maxBufferSizePreparedFor = std::max(resampler.getNoutMax(blockN), blockN);
+        setLatencySamples(preparedBlockSize + int(std::lround((resampler.getLatency() + unsamplerCh1.getLatency()) * fs)));
+    } else {
+        setLatencySamples(preparedBlockSize);
     }
 //    {
 //        sources.load(std::vector<SoundSource>(1));
@@ -1502,6 +1491,7 @@ void ThreeDAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock
     isHostRealTime = !isNonRealtime();
     realTime = (processingMode == ProcessingMode::AUTO_DETECT) ? isHostRealTime.load() : processingMode == ProcessingMode::REALTIME;
     // allocate space in each PlayableSoundSource for processing
+    sourceInput.allocateForMaxBufferSize(maxBufferSizePreparedFor);
     for (auto& s : playableSources) {
         s.allocateForMaxBufferSize(maxBufferSizePreparedFor);
     }
@@ -1525,20 +1515,7 @@ void ThreeDAudioProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer&
     
     // if the plugin is initialized by prepareToPlay()
     if (inited) {
-        // need to update block size if it is not what we expected to make sure we have enough memory alloced for processing
 		N = buffer.getNumSamples();
-		if (N > maxBufferSizePreparedFor) {
-            maxBufferSizePreparedFor = N;
-            // also got to reset the resampler to the new buffer size if the incoming sample rate is not 44.1kHz
-            if (fs != sampleRate_HRTF) {
-                resampler = Resampler(fs, N, sampleRate_HRTF, true);
-                unsamplerCh1 = Resampler(sampleRate_HRTF, N, fs, false);
-                unsamplerCh2 = Resampler(sampleRate_HRTF, N, fs, false);
-                maxBufferSizePreparedFor = std::max(resampler.getNoutMax(), N.load());
-            }
-            for (auto& s : playableSources)
-                s.allocateForMaxBufferSize(maxBufferSizePreparedFor);
-        }
         
         // update playback position stuff
         AudioPlayHead::CurrentPositionInfo positionInfo;
@@ -1577,7 +1554,7 @@ void ThreeDAudioProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer&
         
         // if the playback position does not immediately follow the previous one and it wasn't caused by the looping feature, need to reset the doppler buffer state so that no old audio remaining is played back at the new position
         bool resetProcessingState = false;
-        if (!looped && std::abs(posSECprev - posSEC) > maxBufferSizePreparedFor/fs * 1.1f/*allow for up to 10% error*/)
+        if (!looped && std::abs(posSECprev - posSEC) > std::max(maxBufferSizePreparedFor, N.load())/fs * 1.1f/*allow for up to 10% error*/)
 			resetProcessingState = true;
         posSECprev = posSEC;
         posSECPrevHost = positionInfo.timeInSeconds;
@@ -1600,80 +1577,61 @@ void ThreeDAudioProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer&
             buffer.clear(ch, 0, currentN);
         }
         
-        // got to resample to 44.1kHz if input is a different sample rate because the HRIR data is 44.1kHz
-        // NOTE: size is getNoutMax() b/c we can't tell if the buffer will be long or short until we make the resample call below
-        const int resampledMaxSize = resampler.getNoutMax();
-        STACK_ARRAY(float, inputResampled, resampledMaxSize)
-        if (fs != sampleRate_HRTF) {
-            for (int n = 0; n < resampledMaxSize; ++n)
-                inputResampled[n] = 0;
-            resampler.resampleLinear(&input[0], &inputResampled[0]);
-        }
-        
-        // the net output accumulator for all sources
+        // the wet output of the sources and the dry input it lines up with
         const int outputSize = 2*currentN;
         STACK_ARRAY(float, output, outputSize)
+        STACK_ARRAY(float, dryOutput, outputSize)
         for (int n = 0; n < outputSize; ++n)
             output[n] = 0;
-        
-        // the resampled version ...
-        const int resampledNout = resampler.getNout();
-        const int resampledSize = 2*resampledNout;
-        STACK_ARRAY(float, outputResampled, resampledSize);
-        for (int n = 0; n < resampledSize; ++n)
-            outputResampled[n] = 0;
-        
-        float *inputPtr, *outputPtr;
-        int inputLength;
-        if (fs != sampleRate_HRTF) {
-            inputPtr = &inputResampled[0];
-            outputPtr = &outputResampled[0];
-            inputLength = resampledNout;
-        } else {
-            inputPtr = &input[0];
-            outputPtr = &output[0];
-            inputLength = currentN;
-        }
-        
-        // process the sources
+        // where the playback position is n samples into this buffer
+        const auto getPosSec = [&] (const int n)
         {
-            Sources* copy = nullptr;
-            const std::unique_lock<Mutex> lock (sources.get(copy), std::try_to_lock);
-            if (lock.owns_lock() && copy) {
-                for (int s = 0; s < (const int)copy->size(); ++s)
-                {   // update the moving source position here for those sources automated on a path
-					if (lockSourcesToPaths && playing) {
-						const auto endOfBufferPosSec = (loopingEnabled && posSEC + thisBufferDuration >= loopRegionEnd) ?
-							loopRegionBegin + posSEC + thisBufferDuration - loopRegionEnd : posSEC + thisBufferDuration;
-						(*copy)[s].setParametricPosition(endOfBufferPosSec, playableSources[s].prevPathPosIndex, 
-														 *sourcePathPositionsFromDAW[s]);		
-					}
-					// serves as a single point of update for the positional state to ensure positional continuity btw buffers
-                    playableSources[s].updateFromSoundSource((*copy)[s]);
-                    playableSources[s].setDopplerOn(dopplerOn, speedOfSound);
-                    if (resetProcessingState)
-                        playableSources[s].resetProcessingState();
-                    if (! playableSources[s].getSourceMuted())
-                        playableSources[s].processAudio(inputPtr, inputLength, outputPtr, realTime);
+            const float pos = posSEC + n / fs;
+            return (loopingEnabled && pos >= loopRegionEnd) ? pos + loopRegionBegin - loopRegionEnd : pos;
+        };
+        if (preparedBlockSize == 0) {
+            // the sources only have memory for the buffer size given to prepareToPlay(), so a bigger buffer from the host is processed in pieces of that size instead of allocating more here
+            const int B = hostBlockSizePreparedFor;
+            if (currentN <= B) {
+                processInternalBlock(&input[0], &output[0], currentN, getPosSec(currentN), resetProcessingState);
+            } else {
+                STACK_ARRAY(float, pieceOutput, 2*B)
+                for (int n = 0; n < currentN; n += B) {
+                    const int count = std::min(B, currentN - n);
+                    std::fill_n(&pieceOutput[0], 2*count, 0.0f);
+                    processInternalBlock(&input[n], &pieceOutput[0], count, getPosSec(n + count), resetProcessingState && n == 0);
+                    for (int ch = 0; ch < 2; ++ch)
+                        std::copy_n(&pieceOutput[ch*count], count, &output[ch*currentN + n]);
+                }
+            }
+            for (int n = 0; n < outputSize; ++n)
+                dryOutput[n] = stereoInput[n];
+        } else {
+            // the input is gathered into blocks of preparedBlockSize samples, and each block's output goes out while the next block is gathered
+            const int B = preparedBlockSize;
+            resetBlockProcessingState = resetBlockProcessingState || resetProcessingState;
+            for (int n = 0; n < currentN; ) {
+                const int count = std::min(currentN - n, B - blockFill);
+                for (int i = 0; i < count; ++i) {
+                    blockInput[blockFill + i] = input[n + i];
+                    for (int ch = 0; ch < 2; ++ch) {
+                        blockInput[(1+ch)*B + blockFill + i] = stereoInput[ch*currentN + n + i];
+                        output[ch*currentN + n + i] = blockOutput[ch*B + blockFill + i];
+                        dryOutput[ch*currentN + n + i] = blockOutput[(2+ch)*B + blockFill + i];
+                    }
                 }
-                prevSourcesSize = copy->size();
-                sources.tryToUpdate(copy);
-            } else { // failed to get the lock, so just use the previous PlayableSoundSource data to process this buffer
-                for (int s = 0; s < (const int)prevSourcesSize; ++s)
-                {   // compute approximated position if the source was previously moving since we don't have access to the interps of the locked source.  this is crucial to avoid glitches with the dopper effect on, not so important without the doppler as the ocassional glitches aren't noticable
-                    playableSources[s].advancePosition();
-                    if (! playableSources[s].getSourceMuted())
-                        playableSources[s].processAudio(inputPtr, inputLength, outputPtr, realTime);
+                blockFill += count;
+                n += count;
+                if (blockFill == B) {
+                    std::fill_n(&blockOutput[0], 2*B, 0.0f);
+                    std::copy_n(&blockInput[B], 2*B, &blockOutput[2*B]);
+                    processInternalBlock(&blockInput[0], &blockOutput[0], B, getPosSec(n), resetBlockProcessingState);
+                    resetBlockProcessingState = false;
+                    blockFill = 0;
                 }
             }
         }
         
-        // resample the processed audio back to the original sample rate of the buffer given to us
-        if (fs != sampleRate_HRTF) {
-            unsamplerCh1.unsampleLinear(outputResampled, resampledNout, output);
-            unsamplerCh2.unsampleLinear(&outputResampled[resampledNout], resampledNout, &output[currentN]);
-        }
-        
         // copy final data to output buffer
         for (int ch = 0; ch < 2; ++ch)
             buffer.copyFromWithRamp(ch, 0, &output[ch*currentN], currentN, 0.18f * prevWetOutputVolume, 0.18f * wetOutputVolume);
@@ -1684,7 +1642,7 @@ void ThreeDAudioProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer&
             cauto dovInc = (dryOutputVolume - prevDryOutputVolume) / currentN;
             for (int ch = 0; ch < 2; ++ch)
                 for (int n = 0; n < currentN; ++n)
-                    *buffer.getWritePointer(ch, n) += stereoInput[ch*currentN + n] * (dovStart + dovInc * n);
+                    *buffer.getWritePointer(ch, n) += dryOutput[ch*currentN + n] * (dovStart + dovInc * n);
         }
         
         prevWetOutputVolume = wetOutputVolume;
@@ -1692,6 +1650,106 @@ void ThreeDAudioProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer&
     } // end if inited
 }
 
+// processes one block of the mono input through the sources, adding their output to output (blockN left samples followed by blockN right samples).
+// endPosSec is the playback position at the end of the block, which is where the sources locked to their paths are moved to over the block
+void ThreeDAudioProcessor::processInternalBlock(const float* input, float* output, const int blockN, const float endPosSec, const bool resetProcessingState)
+{
+    const float blockDuration = blockN / fs;
+    // got to resample to 44.1kHz if input is a different sample rate and the HRIR data has not been resampled to it
+    // NOTE: size is getNoutMax() b/c we can't tell if the buffer will be long or short until we make the resample call below
+    const bool resampling = fs != processingRate;
+    const int resampledMaxSize = resampling ? resampler.getNoutMax(blockN) : 0;
+    STACK_ARRAY(float, inputResampled, resampledMaxSize)
+    const int resampledNout = resampling ? resampler.resample(input, blockN, &inputResampled[0]) : 0;
+    
+    // the resampled version ...
+    const int resampledSize = 2*resampledNout;
+    STACK_ARRAY(float, outputResampled, resampledSize);
+    for (int n = 0; n < resampledSize; ++n)
+        outputResampled[n] = 0;
+    
+    const float* inputPtr;
+    float* outputPtr;
+    int inputLength;
+    if (resampling) {
+        inputPtr = &inputResampled[0];
+        outputPtr = &outputResampled[0];
+        inputLength = resampledNout;
+    } else {
+        inputPtr = input;
+        outputPtr = output;
+        inputLength = blockN;
+    }
+    
+    // every source convolves the same input, so its history (and its spectra for the fft engine) is only kept once
+    sourceInput.setConvolutionEngine(convolutionEngine);
+    sourceInput.setDopplerOn(dopplerOn && dopplerEngine == DopplerEngine::FRACTIONAL_DELAY);
+    if (resetProcessingState)
+        sourceInput.reset();
+    sourceInput.load(inputPtr, inputLength);
+    
+    // the sources can only be processed once the hrir data is loaded (in the background), until then there is no wet output
+    const HRIRTable* const table = audioHRIRdata.load()->getTable();
+    if (table) {
+        // process the sources, the stationary ones are gathered up and processed together afterwards
+        stationarySources.clear();
+        {
+            // the latest sources the gui threads published, which never has to wait on them or copy anything
+            const auto snapshot = sources.read();
+            if (snapshot) {
+                const int numSources = (int)snapshot->size();
+                const std::uint64_t version = snapshot.getVersion();
+                for (int s = 0; s < numSources; ++s)
+                {
+                    const SoundSource& source = (*snapshot)[s];
+                    // update the moving source position here for those sources automated on a path, which is passed back to the gui threads.
+                    // the snapshot is not changed, so a source moved along its path stays where it was moved to until the gui threads publish a newer snapshot (which has that position)
+                    bool movedOnPath = false;
+                    if (lockSourcesToPaths && playing) {
+                        const bool moved = movedOnPathVersions[s] == version;
+                        std::array<float, 3> rae = moved ? playableSources[s].getPosRAE() : source.getPosRAE();
+                        bool muted = moved ? playableSources[s].getSourceMuted() : source.getSourceMuted();
+                        if (source.getParametricPosition(endPosSec, playableSources[s].prevPathPosIndex, *sourcePathPositionsFromDAW[s], rae, muted)) {
+                            playableSources[s].setPosition(rae, muted);
+                            sources.setPositionUpdate(s, rae, muted, numSources);
+                            movedOnPathVersions[s] = version;
+                            movedOnPath = true;
+                        }
+                    }
+					// serves as a single point of update for the positional state to ensure positional continuity btw buffers
+                    if (!movedOnPath && movedOnPathVersions[s] != version)
+                        playableSources[s].updateFromSoundSource(source);
+                    playableSources[s].setHRIRTable(table);
+                    // the positions of sources locked to their paths are known ahead of time, so get the hrir data they will need in the next buffers into the cpu cache now
+                    if (lockSourcesToPaths && playing && ! playableSources[s].getSourceMuted()) {
+                        for (int b = 1; b <= numHRIRPrefetchBuffers; ++b) {
+                            auto aheadPosSec = endPosSec + b * blockDuration;
+                            if (loopingEnabled && aheadPosSec >= loopRegionEnd)
+                                aheadPosSec += loopRegionBegin - loopRegionEnd;
+                            std::array<float, 3> aheadRAE;
+                            if (source.getParametricPosition(aheadPosSec, playableSources[s].lookaheadPathPosIndex, aheadRAE))
+                                playableSources[s].prefetchHRIRs(aheadRAE);
+                        }
+                    }
+                    playableSources[s].setDopplerOn(dopplerOn, speedOfSound, dopplerEngine, monoDoppler);
+                    if (resetProcessingState)
+                        playableSources[s].resetProcessingState();
+                    if (! playableSources[s].getSourceMuted() && ! stationarySources.add(playableSources[s]))
+                        playableSources[s].processAudio(sourceInput, outputPtr, realTime);
+                }
+            }
+        }
+        stationarySources.processAudio(sourceInput, outputPtr);
+    }
+    sourceInput.advance();
+    
+    // resample the processed audio back to the original sample rate of the buffer given to us
+    if (resampling) {
+        unsamplerCh1.unsample(outputResampled, resampledNout, output, blockN);
+        unsamplerCh2.unsample(&outputResampled[resampledNout], resampledNout, &output[blockN], blockN);
+    }
+}
+
 //==============================================================================
 bool ThreeDAudioProcessor::hasEditor() const
 {
@@ -1727,12 +1785,20 @@ void ThreeDAudioProcessor::getStateInformation (MemoryBlock& destData)
     xml.setAttribute("loopRegionEnd", loopRegionEnd);
     xml.setAttribute("loopingEnabled", loopingEnabled);
     xml.setAttribute("processingMode", (int)processingMode.load());
+    xml.setAttribute("convolutionEngine", (int)convolutionEngine.load());
+    xml.setAttribute("nativeRateHRIRs", nativeRateHRIRs.load());
+    xml.setAttribute("resamplingQuality", (int)resamplingQuality.load());
+    xml.setAttribute("internalBlockSize", internalBlockSize.load());
+    xml.setAttribute("dopplerEngine", (int)dopplerEngine.load());
+    xml.setAttribute("monoDoppler", monoDoppler.load());
     xml.setAttribute("wetOutputVolume", wetOutputVolume.load());
     xml.setAttribute("dryOutputVolume", dryOutputVolume.load());
     // add all the data from the sources array
     {
         Sources* copy = nullptr;
         const Locker lock (sources.get(copy));
+        // with the sources where the audio thread moved them along their paths
+        sources.applyPositionUpdates();
         if (copy) {
             for (const auto& source : *copy)
                 xml.addChildElement(source.getXML());
@@ -1764,6 +1830,12 @@ void ThreeDAudioProcessor::setStateInformation (const void* data, int sizeInByte
             loopRegionEnd = xmlState->getDoubleAttribute("loopRegionEnd", -1.0);
             loopingEnabled = xmlState->getBoolAttribute("loopingEnabled", loopRegionBegin != -1 && loopRegionEnd != -1);
             setProcessingMode((ProcessingMode)xmlState->getIntAttribute("processingMode", 2));
+            convolutionEngine = (ConvolutionEngine)xmlState->getIntAttribute("convolutionEngine", (int)ConvolutionEngine::TIME_DOMAIN);
+            nativeRateHRIRs = xmlState->getBoolAttribute("nativeRateHRIRs", true);
+            resamplingQuality = (ResamplingQuality)xmlState->getIntAttribute("resamplingQuality", (int)ResamplingQuality::MEDIUM);
+            internalBlockSize = xmlState->getIntAttribute("internalBlockSize", 0);
+            dopplerEngine = (DopplerEngine)xmlState->getIntAttribute("dopplerEngine", (int)DopplerEngine::SCATTER);
+            monoDoppler = xmlState->getBoolAttribute("monoDoppler", false);
             wetOutputVolume = xmlState->getDoubleAttribute("wetOutputVolume", 1.0);
             dryOutputVolume = xmlState->getDoubleAttribute("dryOutputVolume", 0.0);
             // restore all the saved sources and their state stuff
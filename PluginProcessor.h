@@ -36,19 +36,60 @@
 #include "SoundSource.h"
 #include "Resampler.h"
 #include "ConcurrentResource.h"
+#include "HRIRTable.h"
 
-// keeps track of the number of plugin instances so we can only use one copy of the HRIR data
-static int numRefs = 0;
 // possible states for GUI display
 enum class DisplayState { MAIN, PATH_AUTOMATION, SETTINGS, NUM_DISPLAY_STATES };
 // realtime is lightest on cpu and will not glitch, offline is expensive on cpu and may glitch, auto-detect assumes the processing mode from the host
 enum class ProcessingMode { REALTIME, OFFLINE, AUTO_DETECT };
 // max number of sound sources
 static constexpr auto maxNumSources = 8;
+// how many buffers ahead the hrir data is prefetched for sources locked to their paths
+static constexpr auto numHRIRPrefetchBuffers = 2;
+// the highest host sample rate that the sources are processed at with the hrir data resampled to it, the resampled hrirs keep their numTimeSteps taps, so above this too much of their tails would be cut off
+static constexpr auto maxNativeHRIRSampleRate = 48000;
 // making life easier
 using Sources = std::vector<SoundSource>;
 using Locker = std::lock_guard<Mutex>;
 
+// the sources, which the (non realtime) gui threads edit through the RealtimeConcurrent copies, and the audio thread reads from the immutable snapshots that load() and update() publish.
+// the audio thread passes the positions it moves the sources to along their paths back through atomics, which get into the copies at the next update() or applyPositionUpdates()
+class SourcesResource : public RealtimeConcurrent<Sources, 3>, private Timer
+{
+public:
+    using Snapshots = SnapshotPublisher<Sources, 2>;
+    // the position updates are applied and the snapshots freed on the message thread every so often, whether or not the editor is open to do it more often
+    SourcesResource() { startTimer(1000); }
+    ~SourcesResource() { stopTimer(); }
+    void load(const Sources& resource);
+    // the copy also gets the latest position updates before it is published
+    void update(Sources* updatedCopy);
+    void update(const Sources* updatedCopy);
+    // get the position updates into the copies that no other thread has locked without publishing them (the audio thread has them already), and free the snapshots the audio thread is done with, for the gui threads
+    void applyPositionUpdates();
+    // the latest sources, for the audio thread, which has a slot of its own so it never goes without them
+    Snapshots::Reader read() const noexcept { return snapshots.readReserved(); }
+    // pass back the position of a source moved along its path in a snapshot of numSources sources, for the audio thread
+    void setPositionUpdate(int sourceIndex, const std::array<float, 3>& posRAE, bool muted, int numSources) noexcept;
+private:
+    void timerCallback() override { applyPositionUpdates(); }
+    // get the position updates that a copy does not have yet into it
+    void takePositionUpdates(Sources& copy, std::size_t copyIndex);
+    // after all of the copies have been updated from one
+    void allCopiesTook(std::size_t copyIndex) noexcept;
+    struct PositionUpdate
+    {
+        std::atomic<std::uint32_t> sequence {0}; // odd while the audio thread is writing the rest, 0 if it never has
+        std::array<std::atomic<float>, 3> posRAE {};
+        std::atomic<bool> muted {false};
+        std::atomic<int> numSources {0}; // the copy has to have as many sources for the update to go to the same one
+    };
+    std::array<PositionUpdate, maxNumSources> positionUpdates;
+    std::array<std::array<std::uint32_t, maxNumSources>, numCopies> takenSequences {}; // of the position updates already in each copy
+    std::mutex takeLock;
+    Snapshots snapshots;
+};
+
 class ThreeDAudioProcessor : public AudioProcessor, public UndoManager
   #ifdef DEMO // demo version only
     , public Timer
@@ -141,6 +182,8 @@ public:
     int getPathAutomationPointIndexAmongSelectedPoints(int sourceIndex, int pointIndex) const;
     bool areAnySelectedSourcesPathAutomationPointsSelected() const;
     void makeSourcesVisibleForPathAutomationView();
+    // fraction of the global hrir data loaded so far, sources can't be heard until it is 1
+    float getHRIRLoadProgress() const noexcept;
     // resets the playing state if processBlock() has not been called in a while, needed because of the logic for moving selected sources
     void resetPlaying(float frameRate) noexcept;
     // for looping
@@ -186,6 +229,21 @@ public:
     std::atomic<ProcessingMode> processingMode {ProcessingMode::AUTO_DETECT};
     std::atomic<bool> realTime {true};
     std::atomic<bool> isHostRealTime {false};
+    // algorithm the sources use for the hrir convolutions, both give the same output (Tools/CheckConvolutionEngines.cpp), the time domain one costs less at the usual host buffer sizes
+    std::atomic<ConvolutionEngine> convolutionEngine {ConvolutionEngine::TIME_DOMAIN};
+    // process the sources at the host's sample rate with the hrir data resampled to it (up to maxNativeHRIRSampleRate), rather than resampling the audio to and from the hrir data's rate, takes effect at the next prepareToPlay()
+    std::atomic<bool> nativeRateHRIRs {true};
+    // filter length of the sample rate conversion to and from the hrir data's rate when it is needed, takes effect at the next prepareToPlay()
+    std::atomic<ResamplingQuality> resamplingQuality {ResamplingQuality::MEDIUM};
+    void setResamplingQuality(ResamplingQuality newQuality);
+    // the sources are processed in blocks of this many samples, so that their positions and hrirs are updated at the same rate (and for the same cpu cost) whatever the host's buffer size.
+    // it delays the output by that many samples (64 is a good size) unless the host's buffers are that size, 0 processes the host's buffers as they come without adding latency, takes effect at the next prepareToPlay()
+    std::atomic<int> internalBlockSize {0};
+    void setInternalBlockSize(int newInternalBlockSize);
+    // how the sources' doppler effect is computed
+    std::atomic<DopplerEngine> dopplerEngine {DopplerEngine::SCATTER};
+    // with the fractional delay engine, apply one doppler delay per source (for the center of the head) before the hrir rather than one per ear, see Tools/MeasureMonoDoppler.cpp for how much that changes
+    std::atomic<bool> monoDoppler {false};
     // show the controls for that view
     //bool showHelp = false;
     // for letting the GL know when its display lists for drawing the path and pathPos interps for each source are updated
@@ -194,7 +252,7 @@ public:
     //std::array<std::atomic<bool>, maxNumSources> pathChangeds;
     //std::array<std::atomic<bool>, maxNumSources> pathPosChangeds;
     // the visual representation of sound sources along with temporary copies to support undo/redos
-    RealtimeConcurrent<Sources, 3> sources;
+    SourcesResource sources;
     //AudioPlayHead::CurrentPositionInfo gPositionInfo;
     std::array<std::atomic<AudioParameterFloat*>, maxNumSources> sourcePathPositionsFromDAW; // for source position automation from DAW
     std::atomic<float> wetOutputVolume {1.0f};
@@ -209,18 +267,49 @@ private:
     float prevWetOutputVolume = wetOutputVolume;
     float prevDryOutputVolume = dryOutputVolume;
 	int maxBufferSizePreparedFor = -1;
+    // the largest buffer from the host processed at once, see processBlock()
+    int hostBlockSizePreparedFor = 0;
+    // keep the background threads shared by all of the plugin instances going while this one is around, so they are declared before the hrir data and sources that use them
+    HRIRStore::User hrirStoreUser;
+    DopplerBuffer::BackgroundThreadUser dopplerBufferThreadUser;
+    // the hrir data at processingRate, which is shared by all of the plugin instances.
+    // it is only replaced with std::atomic_store() and read with std::atomic_load(), except by the audio thread which uses audioHRIRdata to not touch the reference count
+    std::shared_ptr<const HRIRTableLoader> HRIRdata;
+    // HRIRdata's loader, set along with it and kept alive by it
+    std::atomic<const HRIRTableLoader*> audioHRIRdata {nullptr};
+    void setHRIRdata(std::shared_ptr<const HRIRTableLoader> newHRIRdata) noexcept;
+    // calls prepareToPlay() again with the host's current settings
+    void reprepare();
+    File HRIRDataFile;
+    File HRIRCacheFile;
+    // the sample rate the sources are processed at, fs or the hrir data's own
+    float processingRate = sampleRate_HRTF;
+    // processes one block of the sources, see processBlock()
+    void processInternalBlock(const float* input, float* output, int blockN, float endPosSec, bool resetProcessingState);
+    // the blocks processed when internalBlockSize is set and differs from the host's buffer size, the mono input followed by the stereo dry input of the block being gathered,
+    // and the output of the last block (its left and right wet output followed by its dry input) which goes out while the next is gathered
+    int preparedBlockSize = 0;
+    int blockFill = 0;
+    std::vector<float> blockInput;
+    std::vector<float> blockOutput;
+    bool resetBlockProcessingState = false;
     // version of sources that can be used to process audio, only updated in processBlock() and is therefore thread-safe to use for processing
     std::vector<PlayableSoundSource> playableSources;
-    int prevSourcesSize = 0; // see processBlock() for useage
+    // the input history shared by all of the playableSources
+    SourceInput sourceInput;
+    // processes all of the stationary playableSources with one convolution per ear
+    StationarySources stationarySources;
+    // the version of the sources snapshot that each source was last moved along its path in, the source stays where it was moved to until a newer snapshot comes
+    std::array<std::uint64_t, maxNumSources> movedOnPathVersions {};
     // temporary SoundSource copies to support undo/redos
     Sources beforeUndo;
     Sources currentUndo;
 //    Lockable<Sources> beforeUndo;
 //    Lockable<Sources> currentUndo;
     // objects for sample rate conversion
-    Resampler resampler;
-    Resampler unsamplerCh1;
-    Resampler unsamplerCh2;
+    PolyphaseResampler resampler;
+    PolyphaseResampler unsamplerCh1;
+    PolyphaseResampler unsamplerCh2;
     // previous buffer's time position from this plugin's perspective
     float posSECprev = 0;
     // prev buf time position from host's perspective
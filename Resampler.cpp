@@ -25,111 +25,245 @@
  */
 
 #include "Resampler.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+  #define RESAMPLER_KERNELS_X86
+  #include <immintrin.h>
+  #ifdef _MSC_VER
+    #include <intrin.h>
+    #define TARGET_AVX2
+  #else // gcc/clang only let avx2 intrinsics be used in functions compiled for avx2
+    #define TARGET_AVX2 __attribute__((target("avx2,fma")))
+  #endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+  #define RESAMPLER_KERNELS_NEON
+  #include <arm_neon.h>
+#endif
+#define TARGET_NONE
 
-Resampler::Resampler(double new_fs_in, int new_N_in_out, double new_fs_out, bool direction) noexcept
-    : fs_in(new_fs_in), fs_out(new_fs_out), dir(direction)
+// the filtering of PolyphaseResampler, output n is taken at position + n*step samples into x (position >= -1, and the numTaps samples before x[0] must be valid too).
+// it is the dot product of the numTaps samples of x ending at the whole part of the position with the filter phase for its fractional part,
+// linearly interpolated from the two nearest of the numPhases+1 phases (numTaps taps each, numTaps being a multiple of PolyphaseResampler::tapMultiple).
+// there is a version for each instruction set, the one used is picked at runtime from what the cpu supports (the same way as ConvolutionKernels.cpp)
+typedef void (*PolyphaseKernel)(const float* x, const float* phases, int numTaps, int numPhases,
+                                double position, double step, float* y, int N);
+
+// stamps out the kernel for an instruction set given its function for the dot products of x with two phases at once
+#define POLYPHASE_KERNEL(ISA, TARGET) \
+TARGET static void interpolatePolyphase##ISA(const float* x, const float* phases, const int numTaps, const int numPhases, \
+                                             const double position, const double step, float* y, const int N) \
+{ \
+    for (int n = 0; n < N; ++n) { \
+        const double u = position + n * step; \
+        const int k = int(std::floor(u)); \
+        const double phase = (u - k) * numPhases; \
+        const int p = int(phase); \
+        float sum1, sum2; \
+        dotPair##ISA(&x[k - (numTaps - 1)], &phases[p * numTaps], &phases[(p + 1) * numTaps], numTaps, sum1, sum2); \
+        y[n] = sum1 + (sum2 - sum1) * float(phase - p); \
+    } \
+}
+
+#if !defined(RESAMPLER_KERNELS_X86) && !defined(RESAMPLER_KERNELS_NEON)
+/***** scalar *****/
+static inline void dotPairScalar(const float* x, const float* h1, const float* h2, const int Nh, float& sum1, float& sum2) noexcept
 {
-    if (dir) {
-        // 2nd param is N_in for the resampler
-        N_in = new_N_in_out;
-        N_out = fs_out * ((double)N_in) / fs_in;
-    } else {
-        // 2nd param is N_out for the unsampler
-        N_out = new_N_in_out;
-        N_in = fs_in * N_out / fs_out;
-        N_in += 1;
+    sum1 = sum2 = 0;
+    for (int j = 0; j < Nh; ++j) {
+        sum1 += x[j] * h1[j];
+        sum2 += x[j] * h2[j];
     }
 }
 
-// linearly resamples N_in samples in x at fs_in and spits out ceil(N_out) samples in y at fs_out
-void Resampler::resampleLinear(const float* x, float *y) noexcept
+POLYPHASE_KERNEL(Scalar, TARGET_NONE)
+#endif // scalar
+
+#ifdef RESAMPLER_KERNELS_X86
+/***** SSE *****/
+static inline float horizontalSum(const __m128 v) noexcept
+{
+    const __m128 s = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    return _mm_cvtss_f32(_mm_add_ss(s, _mm_shuffle_ps(s, s, 1)));
+}
+
+static inline void dotPairSSE(const float* x, const float* h1, const float* h2, const int Nh, float& sum1, float& sum2) noexcept
 {
-    int Nout = N_out;//ceil(N_out);
-    const double this_fs_in = fs_in;
-    const double this_fs_out = fs_out;
-    const double Ts_in = 1.0 / this_fs_in;
-    const double Ts_out = 1.0 / this_fs_out;
-    const double this_offset = offset;
-    const double thisPrevSample = prevSample;
-    if (((double)Nout) * Ts_out + this_offset >= ((double)N_in) * Ts_in) {
-        y[Nout] = 0; // set last output sample to 0 since it is not technically in this output buffer
-        shortBuffer = true;
-    } else {
-        Nout += 1;
-        shortBuffer = false;
+    __m128 s1 = _mm_setzero_ps(), s2 = _mm_setzero_ps();
+    for (int j = 0; j < Nh; j += 4) {
+        const __m128 xj = _mm_loadu_ps(&x[j]);
+        s1 = _mm_add_ps(s1, _mm_mul_ps(xj, _mm_loadu_ps(&h1[j])));
+        s2 = _mm_add_ps(s2, _mm_mul_ps(xj, _mm_loadu_ps(&h2[j])));
     }
-    const int thisNout = Nout;
-    int k_low;
-    float x_low, x_high;
-    double t_out, t_in;
-    for (int n = 0; n < thisNout; ++n) {
-        t_out = ((double)n) * Ts_out + this_offset;
-        k_low = t_out * this_fs_in;
-        if (k_low == 0) {
-            x_low = thisPrevSample;
-        } else {
-            x_low = x[k_low-1];
-        }
-        x_high = x[k_low];
-        t_in = ((double)k_low) * Ts_in;
-        // y = b     + m                               * x
-        y[n] = x_low + ((x_high - x_low) * this_fs_in) * (t_out - t_in);
+    sum1 = horizontalSum(s1);
+    sum2 = horizontalSum(s2);
+}
+
+POLYPHASE_KERNEL(SSE, TARGET_NONE)
+
+/***** AVX2 + FMA *****/
+TARGET_AVX2 static inline float horizontalSum(const __m256 v) noexcept
+{
+    return horizontalSum(_mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1)));
+}
+
+TARGET_AVX2 static inline void dotPairAVX2(const float* x, const float* h1, const float* h2, const int Nh, float& sum1, float& sum2) noexcept
+{
+    __m256 s1 = _mm256_setzero_ps(), s2 = _mm256_setzero_ps();
+    for (int j = 0; j < Nh; j += 8) {
+        const __m256 xj = _mm256_loadu_ps(&x[j]);
+        s1 = _mm256_fmadd_ps(xj, _mm256_loadu_ps(&h1[j]), s1);
+        s2 = _mm256_fmadd_ps(xj, _mm256_loadu_ps(&h2[j]), s2);
     }
-    offset = (((double)thisNout) * Ts_out + this_offset) - ((double)N_in) * Ts_in;
-    prevSample = x[N_in-1];
+    sum1 = horizontalSum(s1);
+    sum2 = horizontalSum(s2);
 }
 
-void Resampler::unsampleLinear(const float* x, const int Nin, float* y) noexcept
+POLYPHASE_KERNEL(AVX2, TARGET_AVX2)
+
+static bool cpuSupportsAVX2() noexcept
 {
-    const double this_fs_in = fs_in;
-    const double this_fs_out = fs_out;
-    const double Ts_in = 1.0 / this_fs_in;
-    const double Ts_out = 1.0 / this_fs_out;
-    const double this_offset = offset;
-    const double thisPrevSample = prevSample;
-    const int thisNout = N_out;
-    int k_low;
-    float x_low, x_high;
-    double t_out, t_in;
-    for (int n = 0; n < thisNout; ++n) {
-        t_out = ((double)n) * Ts_out + this_offset;
-        k_low = t_out * this_fs_in;
-        if (k_low == 0) {
-            x_low = thisPrevSample;
-        } else {
-            x_low = x[k_low-1];
-        }
-        x_high = x[k_low];
-        t_in = ((double)k_low) * Ts_in;
-        // y = b     + m                             * x
-        y[n] = x_low + (x_high - x_low) * this_fs_in * (t_out - t_in);
+  #ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+    // fma and the os saving the ymm registers
+    __cpuid(info, 1);
+    if ((info[2] & (1 << 12)) == 0 || (info[2] & (1 << 27)) == 0 || (_xgetbv(0) & 6) != 6)
+        return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+  #else
+    __builtin_cpu_init(); // needed since this runs during static initialization
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+  #endif
+}
+#endif // RESAMPLER_KERNELS_X86
+
+#ifdef RESAMPLER_KERNELS_NEON
+/***** NEON *****/
+static inline float horizontalSum(const float32x4_t v) noexcept
+{
+  #if defined(__aarch64__) || defined(_M_ARM64)
+    return vaddvq_f32(v);
+  #else
+    const float32x2_t s = vadd_f32(vget_low_f32(v), vget_high_f32(v));
+    return vget_lane_f32(vpadd_f32(s, s), 0);
+  #endif
+}
+
+static inline void dotPairNEON(const float* x, const float* h1, const float* h2, const int Nh, float& sum1, float& sum2) noexcept
+{
+    float32x4_t s1 = vdupq_n_f32(0), s2 = vdupq_n_f32(0);
+    for (int j = 0; j < Nh; j += 4) {
+        const float32x4_t xj = vld1q_f32(&x[j]);
+        s1 = vmlaq_f32(s1, xj, vld1q_f32(&h1[j]));
+        s2 = vmlaq_f32(s2, xj, vld1q_f32(&h2[j]));
     }
-    offset = (((double)thisNout) * Ts_out + this_offset) - ((double)Nin) * Ts_in;
-    prevSample = x[Nin-1];
+    sum1 = horizontalSum(s1);
+    sum2 = horizontalSum(s2);
 }
 
-int Resampler::getNout() const noexcept
+POLYPHASE_KERNEL(NEON, TARGET_NONE)
+#endif // RESAMPLER_KERNELS_NEON
+
+static PolyphaseKernel selectPolyphaseKernel() noexcept
+{
+  #if defined(RESAMPLER_KERNELS_X86)
+    return cpuSupportsAVX2() ? interpolatePolyphaseAVX2 : interpolatePolyphaseSSE;
+  #elif defined(RESAMPLER_KERNELS_NEON)
+    return interpolatePolyphaseNEON;
+  #else
+    return interpolatePolyphaseScalar;
+  #endif
+}
+
+// picked once when the plugin is loaded, so the audio thread never has to
+static const PolyphaseKernel interpolatePolyphase = selectPolyphaseKernel();
+
+constexpr int PolyphaseResampler::tapMultiple;
+
+PolyphaseResampler::PolyphaseResampler(double new_fs_in, double new_fs_out, int new_maxNin, ResamplingQuality quality)
+    : fs_in(new_fs_in), fs_out(new_fs_out), maxNin(new_maxNin)
 {
-    if (dir) {
-        // resampling, resamplers have variable buffer size due to the fractional nature of fs_in/fs_out
-        if (shortBuffer) {
-            return N_out;
-        } else {
-            return N_out + 1;
+    // the filter's length is given at the lower rate, so going down in rate it spans more input samples
+    const double ratio = std::max(1.0, fs_in / fs_out);
+    numTaps = int(std::ceil(int(quality) * ratio / tapMultiple)) * tapMultiple;
+    const double cutoff = 0.95 * std::min(1.0, fs_out / fs_in);
+    const double halfWidth = numTaps / 2.0;
+    phases.resize((numPhases + 1) * numTaps);
+    for (int p = 0; p <= numPhases; ++p) {
+        // tap i multiplies the input sample numTaps-1-i before the whole part of the output's position, which is delayed by halfWidth samples
+        const double fraction = double(p) / numPhases;
+        float* phase = &phases[p * numTaps];
+        double sum = 0;
+        for (int i = 0; i < numTaps; ++i) {
+            const double t = fraction + (numTaps - 1 - i) - halfWidth;
+            const double sinc = t == 0 ? 1 : std::sin(M_PI * cutoff * t) / (M_PI * cutoff * t);
+            const double window = 0.42 + 0.5 * std::cos(M_PI * t / halfWidth) + 0.08 * std::cos(2 * M_PI * t / halfWidth);
+            phase[i] = float(sinc * window);
+            sum += phase[i];
         }
-    } else {
-        // unsampling, unsamplers should always output the same number of samples per buffer as was initially fed to the associated resampler
-        return N_out;
+        // unity gain at dc for every phase
+        for (int i = 0; i < numTaps; ++i)
+            phase[i] = float(phase[i] / sum);
     }
+    history.assign(numTaps + maxNin, 0.0f);
+}
+
+int PolyphaseResampler::resample(const float* x, const int Nin, float* y) noexcept
+{
+    int Nout = 0;
+    for (int i = 0; i < Nin; i += maxNin) {
+        const int n = std::min(maxNin, Nin - i);
+        const int thisNout = getNumOutputsWithin(n);
+        filter(&x[i], n, &y[Nout], thisNout);
+        Nout += thisNout;
+    }
+    return Nout;
+}
+
+void PolyphaseResampler::unsample(const float* x, const int Nin, float* y, const int Nout) noexcept
+{
+    // the output positions line up with the input, so all but the last of the outputs (which may be up to a sample before the end of the input) are within it
+    int i = 0, n = 0;
+    do {
+        const int thisNin = std::min(maxNin, Nin - i);
+        const int thisNout = i + thisNin < Nin ? std::min(Nout - n, getNumOutputsWithin(thisNin)) : Nout - n;
+        filter(&x[i], thisNin, &y[n], thisNout);
+        i += thisNin;
+        n += thisNout;
+    } while (i < Nin);
+}
+
+int PolyphaseResampler::getNumOutputsWithin(const int Nin) const noexcept
+{
+    return std::max(0, int(std::ceil((Nin - offset) * fs_out / fs_in)));
+}
+
+void PolyphaseResampler::filter(const float* x, const int Nin, float* y, const int Nout) noexcept
+{
+    const double step = fs_in / fs_out;
+    std::copy_n(x, Nin, &history[numTaps]);
+    assert(numTaps % tapMultiple == 0);
+    interpolatePolyphase(&history[numTaps], phases.data(), numTaps, numPhases, offset, step, y, Nout);
+    offset += Nout * step - Nin;
+    // keep the end of this input for filtering the start of the next
+    if (Nin > 0)
+        std::copy(&history[Nin], &history[Nin + numTaps], history.begin());
+}
+
+int PolyphaseResampler::getNoutMax(const int Nin) const noexcept
+{
+    // the positions start no more than a sample before the input
+    return int(std::ceil((Nin + 1) * fs_out / fs_in));
 }
 
-// returns the maximum size of the output buffer (used for allocating the output buffer's memory)
-int Resampler::getNoutMax() const noexcept
+double PolyphaseResampler::getLatency() const noexcept
 {
-    if (dir)
-        return N_out + 1;
-    else
-        return N_out;
+    return numTaps / 2 / fs_in;
 }
 
 //int Resampler::getNumSamplesLatency()
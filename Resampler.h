@@ -27,35 +27,48 @@
 #ifndef __Resampler__
 #define __Resampler__
 
-// NOTE: this whole setup assumes that 1/fs_out !> N_in / fs_in. that is that there is not less than one sample per output buffer on average.
-class Resampler
+#include <vector>
+
+// length of PolyphaseResampler's filter, in taps at the lower of the two sample rates
+enum class ResamplingQuality { LOW = 16, MEDIUM = 32, HIGH = 64 };
+
+// band limited resampler, each output sample is filtered from the input by a blackman windowed sinc (which also low passes below the output's nyquist frequency when going down in rate).
+// the filter is kept as a table of its phases (fractional delays), and the audio is delayed by getLatency().
+// it streams buffers of any length, the input goes through a fifo of the filter's history and up to maxNin new samples at a time, so nothing is allocated after construction.
+class PolyphaseResampler
 {
 public:
-    Resampler() noexcept {};
-    Resampler(double new_fs_in, int new_N_in, double new_fs_out, bool direction) noexcept;
-    ~Resampler() {};
-    void resampleLinear(const float* x, float* y) noexcept;
-    void unsampleLinear(const float* x, int Nin, float* y) noexcept;
-    int getNout() const noexcept;
-    int getNoutMax() const noexcept ;
-    //int getNumSamplesLatency();
+    PolyphaseResampler() noexcept {};
+    PolyphaseResampler(double new_fs_in, double new_fs_out, int new_maxNin, ResamplingQuality quality);
+    // resamples the Nin samples in x at fs_in to y at fs_out, returns the number of samples output, which is at most getNoutMax(Nin)
+    int resample(const float* x, int Nin, float* y) noexcept;
+    // resamples the Nin samples in x back to exactly Nout samples in y, where x is what another PolyphaseResampler going the other way resample()d from Nout samples
+    void unsample(const float* x, int Nin, float* y, int Nout) noexcept;
+    // maximum number of samples output for Nin input samples
+    int getNoutMax(int Nin) const noexcept;
+    // delay of the filter in seconds
+    double getLatency() const noexcept;
 private:
+    // filters Nout samples into y, with the Nin (up to maxNin) samples of x pushed through the fifo
+    void filter(const float* x, int Nin, float* y, int Nout) noexcept;
+    // number of output samples whose positions are within the next Nin input samples
+    int getNumOutputsWithin(int Nin) const noexcept;
+    static constexpr int numPhases = 256;
+    // numTaps is rounded up to a multiple of the most taps the filtering takes at once (the avx2 vector width)
+    static constexpr int tapMultiple = 8;
     // input sample rate
     double fs_in = 44100;
     // output sample rate
     double fs_out = 44100;
-    // length of input buffer
-    int N_in = 0;
-    // length of output buffer (fraction due to sample rate change, however resample only outputs floor(N_out) samples per input buffer and the appropriate time shifting is taken care of with the computation of those samples)
-    double N_out = 0;
-    // direction of resampling: true = resample, false = unsample
-    bool dir = true;
-    // last sample of the previous input
-    double prevSample = 0;
-    // the time offset of the first resampled sample from the actual begin time of the input buffer, due to the fact that N_out is fractional in nature
+    // most input samples filtered at once
+    int maxNin = 0;
+    // the filter length and its numPhases+1 phases, whose taps are in time order of the input samples they multiply
+    int numTaps = 0;
+    std::vector<float> phases;
+    // the fifo, the last numTaps input samples followed by the input being filtered
+    std::vector<float> history;
+    // position of the next output sample, in input samples from the start of the next input (can be up to a sample before it for the unsampler)
     double offset = 0;
-    // state variable(s) to indicate when we are outputing the occasional "short" buffer from the resampler and when we are indexing into "short" buffers when unsampling
-    bool shortBuffer = false;
 };
 
 ////#include <stdio.h>
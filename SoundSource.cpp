@@ -26,7 +26,9 @@
 
 #include "SoundSource.h"
 #include "Functions.h"
+#include "ConvolutionKernels.h"
 #include <string>
+#include <algorithm>
 
 // fuckin C++ man
 template <class T_SRC, class T_DEST>
@@ -353,6 +355,42 @@ bool SoundSource::setParametricPosition(const float posSec, int& prevPathPosInde
     return setPosFromPath;
 }
 
+bool SoundSource::getParametricPosition(const float posSec, int& pathPosIndex, std::array<float, 3>& rae) const
+{
+    float y;
+    if (path.get() == nullptr || path->getNumPoints() < 2 || pathPos.getNumPoints() == 0 || !pathPos.pointAtSmart(posSec, &y, pathPosIndex) || y != y)
+        return false;
+    float xyz[4]; // room for the eleDir stored in the 4th dim, see setParametricPosition()
+    float range[2];
+    path->getInputRangeQuick(range);
+    if (!path->pointAt(y * range[1] * 0.999999f, xyz))
+        return false;
+    XYZtoRAE(xyz, &rae[0]);
+    rae[0] = std::max(rae[0], (float)distanceBegin);
+    return true;
+}
+
+bool SoundSource::getParametricPosition(const float posSec, int& prevPathPosIndex, const float parametricPositionFromDAW, std::array<float, 3>& rae, bool& muted) const
+{
+    if (path.get() == nullptr || path->getNumPoints() < 2)
+        return false;
+    float y = parametricPositionFromDAW; // if no pathPos points, use the plugin parameters from with the DAW
+    if (pathPos.getNumPoints() && !pathPos.pointAtSmart(posSec, &y, prevPathPosIndex)) {
+        muted = true;
+        return true;
+    }
+    muted = false;
+    float xyz[4]; // room for the eleDir stored in the 4th dim, see setParametricPosition()
+    float range[2];
+    path->getInputRangeQuick(range);
+    if (y == y && path->pointAt(y * range[1] * 0.999999f, xyz)) {
+        XYZtoRAE(xyz, &rae[0]);
+        float eleDirection = eleDir;
+        boundsCheckRAE(rae, eleDirection);
+    }
+    return true;
+}
+
 void SoundSource::setPositionUpdate(const std::array<float,3>& newPosRAE, const bool newMuted)
 {
     posRAE = newPosRAE;
@@ -672,31 +710,159 @@ bool SoundSource::setSelectedPathAutomationPointsSegmentType(const int newSegTyp
 }
 
 
+/***** InputHistory *****/
+void InputHistory::allocateForMaxBufferSize(const int N_max)
+{
+    Nmax = N_max;
+    // the fft engine's overlap-save windows reach back up to two partitions before the buffer
+	inputBufferSize = std::max<int>(Nmax * (std::ceil(float(numTimeSteps - 1) / float(Nmax)) + 1),
+                                    Nmax + 2 * convolutionPartitionSize);
+    // mirrored for the simd convolution kernels
+    inputBuffer.resize(2 * inputBufferSize, 0.0f);
+    convolverInput.allocate(Nmax, numTimeSteps, convolutionPartitionSize);
+    InputHistory::reset();
+}
+
+void InputHistory::reset() noexcept
+{
+    for (auto& x : inputBuffer)
+        x = 0;
+    inputBufferInPos = 0;
+    inputBufferOutPos = 0;
+    convolverInput.reset();
+}
+
+void InputHistory::load(const float* in, const int numSamples, const bool transform) noexcept
+{
+    N = numSamples;
+	for (int n = 0; n < N; ++n) {
+		inputBuffer[inputBufferInPos] = inputBuffer[inputBufferInPos + inputBufferSize] = in[n];
+		inputBufferInPos = (inputBufferInPos + 1) % inputBufferSize;
+	}
+    // the input spectra are only kept while the fft engine is in use
+    if (transform != transformed) {
+        transformed = transform;
+        convolverInput.reset();
+    }
+    if (transform)
+        convolverInput.transform(&inputBuffer[0], inputBufferOutPos, inputBufferSize, N);
+}
+
+void InputHistory::advance() noexcept
+{
+	inputBufferOutPos = (inputBufferOutPos + N) % inputBufferSize;
+}
+
+/***** SourceInput *****/
+void SourceInput::allocateForMaxBufferSize(const int N_max)
+{
+    InputHistory::allocateForMaxBufferSize(N_max);
+    if (dopplerOn)
+        dopplerDelayLine.allocate(defaultDopplerMaxDistance, Nmax, minDopplerSpeedOfSound);
+    dopplerDelayLine.reset();
+}
+
+void SourceInput::setDopplerOn(const bool newDopplerOn) noexcept
+{
+    // freeing is tried again each time the doppler effect is off, in case the last memory handed off was still being freed
+    if (newDopplerOn)
+        dopplerDelayLine.allocateInBackground(defaultDopplerMaxDistance, Nmax, minDopplerSpeedOfSound);
+    else
+        dopplerDelayLine.freeInBackground();
+    dopplerOn = newDopplerOn;
+}
+
+void SourceInput::setDopplerSampleRate(const float sampleRate) noexcept
+{
+    dopplerDelayLine.setSampleRate(sampleRate);
+}
+
+void SourceInput::reset() noexcept
+{
+    InputHistory::reset();
+    dopplerDelayLine.reset();
+}
+
+void SourceInput::load(const float* in, const int numSamples) noexcept
+{
+    InputHistory::load(in, numSamples, convolutionEngine == ConvolutionEngine::PARTITIONED_FFT);
+    if (dopplerOn)
+        dopplerDelayLine.write(in, numSamples);
+}
+
+// pre-convolution normalization of a left/right hrir pair, each channel is divided by its L1 norm which goes into scaling[ch] for scaling the convolution output back up.
+// a silent channel (e.g. the zeros hrir data when the hrir file is missing) is left as is with a scaling of 0, instead of turning into NaNs.
+static void normalizeHRIR(float* hrir, float* scaling) noexcept
+{
+    for (int ch = 0; ch < 2; ++ch) {
+        float* h = &hrir[ch*numTimeSteps];
+        float norm = 0;
+        for (int n = 0; n < numTimeSteps; ++n)
+            norm += std::abs(h[n]);
+        scaling[ch] = norm;
+        if (norm > 0) {
+            const float oneOverNorm = 1.0f/norm;
+            for (int n = 0; n < numTimeSteps; ++n)
+                h[n] *= oneOverNorm;
+        }
+    }
+}
+
+// the radial grid of the hrir data (log spaced from distanceBegin to distanceEnd), so that interpolateHRIR() needs no logs or pows to find a source's radial neighbors and weights
+struct RadialGrid
+{
+    RadialGrid() noexcept
+    {
+        for (int d = 0; d < numDistanceSteps; ++d)
+            radius[d] = distanceBegin*std::pow(distanceEnd/distanceBegin, ((float)d)/(numDistanceSteps-1));
+        for (int d = 0; d < numDistanceSteps-1; ++d)
+            oneOverStep[d] = 1.0f/(radius[d+1]-radius[d]);
+    }
+    // the index of the inner of the two grid distances that r is between (the first or last two for an r outside of the grid), counted without branches
+    int innerIndex(const float r) const noexcept
+    {
+        int d = 0;
+        for (int i = 1; i < numDistanceSteps-1; ++i)
+            d += r >= radius[i];
+        return d;
+    }
+    float radius[numDistanceSteps];
+    float oneOverStep[numDistanceSteps-1];
+};
+static const RadialGrid radialGrid;
+
 /***** PlayableSoundSource *****/
 PlayableSoundSource::PlayableSoundSource()
 {
-    interpolateHRIR(&posRAE[0], &HRIR[0]);
-    HRIRScaling[0] = HRIRScaling[1] = 0;//= HRIRScaling[2] = HRIRScaling[3] = 0;
-    for (int n = 0; n < numTimeSteps; ++n) {
-        HRIRScaling[0] += std::abs(HRIR[             n]);
-        //HRIRScaling[2] += std::abs(HRIR[             n]);
-        HRIRScaling[1] += std::abs(HRIR[numTimeSteps+n]);
-        //HRIRScaling[3] += std::abs(HRIR[numTimeSteps+n]);
+    // the hrir gets set once there is hrir data, see setHRIRTable()
+}
+
+void PlayableSoundSource::setHRIRTable(const HRIRTable* const newHRIRdata) noexcept
+{
+    if (HRIRdata != newHRIRdata) {
+        HRIRdata = newHRIRdata;
+        HRIRNeighborCache.numNeighbors = 0;
+        if (HRIRdata) // start right at the current position with the new data
+            resetHRIR();
     }
-    HRIRScaling[0] = 1.0/HRIRScaling[0];
-    HRIRScaling[1] = 1.0/HRIRScaling[1];
+}
+
+void PlayableSoundSource::resetHRIR() noexcept
+{
+    prevRAE = pprevRAE = posRAE;
+    HRIRChange = prevHRIRChange = false;
+    interpolateHRIR(&posRAE[0], &HRIR[0], &HRIRScaling[0]);
     // hoping this (init of HRIRs at construction) might fix the random fuzz issue with moving sources, it did seem to work...
     for (int n = 0; n < numTimeSteps; ++n)
     {
-        HRIR[             n] *= HRIRScaling[0];
-        HRIR[numTimeSteps+n] *= HRIRScaling[1];
-        HRIRs[2*numTimeSteps+n] = HRIRs[             n] = HRIR[             n];// * HRIRScaling[0];
-        //HRIRs[2*numTimeSteps+n] = HRIR[             n];// * HRIRScaling[0];
-        HRIRs[3*numTimeSteps+n] = HRIRs[numTimeSteps+n] = HRIR[numTimeSteps+n];// * HRIRScaling[1];
-        //HRIRs[3*numTimeSteps+n] = HRIR[numTimeSteps+n];// * HRIRScaling[1];
+        HRIRs[2*numTimeSteps+n] = HRIRs[             n] = HRIR[             n];
+        HRIRs[3*numTimeSteps+n] = HRIRs[numTimeSteps+n] = HRIR[numTimeSteps+n];
     }
-    HRIRScaling[2] = HRIRScaling[0] = 1.0/HRIRScaling[0];
-    HRIRScaling[3] = HRIRScaling[1] = 1.0/HRIRScaling[1];
+    HRIRScaling[2] = HRIRScaling[0];
+    HRIRScaling[3] = HRIRScaling[1];
+    interleaveHRIRs(&HRIR[0], numTimeSteps, 1, &HRIRInterleaved[0]);
+    HRIRSpectraValid = false;
+    ++HRIRVersion;
 }
 
 PlayableSoundSource::~PlayableSoundSource()
@@ -729,11 +895,7 @@ void PlayableSoundSource::advancePosition() noexcept
 
 void PlayableSoundSource::updateFromSoundSource(const SoundSource& source) noexcept
 {
-    if (posRAE != source.posRAE)
-    {
-        HRIRChange = true;
-        posRAE = source.posRAE;
-    }
+    setPosition(source.posRAE, source.sourceMuted);
 //    // SMOOTH TRANSITION
 //    if (posRAE != source.posRAE && !HRIRChange)
 //    {
@@ -743,7 +905,16 @@ void PlayableSoundSource::updateFromSoundSource(const SoundSource& source) noexc
 //        currentTransitionTime = nextTransitionTime;//std::min(nextTransitionTime, maxTransitionTime);
 //        nextTransitionTime = 0;
 //    }
-    sourceMuted = source.sourceMuted;
+}
+
+void PlayableSoundSource::setPosition(const std::array<float, 3>& rae, const bool muted) noexcept
+{
+    if (posRAE != rae)
+    {
+        HRIRChange = true;
+        posRAE = rae;
+    }
+    sourceMuted = muted;
 }
 
 std::array<float,3> PlayableSoundSource::getPosRAE() const noexcept
@@ -754,22 +925,24 @@ std::array<float,3> PlayableSoundSource::getPosRAE() const noexcept
 void PlayableSoundSource::allocateForMaxBufferSize(const int N_max)
 {
     Nmax = N_max;
-	inputBuffer.resize(Nmax * (std::ceil(float(numTimeSteps - 1) / float(Nmax)) + 1), 0.0f);
-	inputBufferInPos = 0;
-	inputBufferOutPos = 0;
+    convolver.allocate(numTimeSteps, convolutionPartitionSize, 4);
+    HRIRSpectraValid = false;
 	const int maxNumHRIRs = (Nmax >> 1) + 1; // new hrir position for each 2 samples seems more than sufficient...
 	hqHRIRs.resize(maxNumHRIRs * 2 * numTimeSteps, 0);
 	hqHRIRScaling.resize(maxNumHRIRs * 2, 0);
+    HRIRsInterleaved.resize(std::max<int>(maxNumHRIRs, 2) * 2 * numTimeSteps, 0);
     //inputs.resize(std::ceil((float)(numTimeSteps-1)/((float)Nmax)) + 1);
     //for (auto& input : inputs)
     //    input.setSize(Nmax);
     //newInputIndex = 0;
-    if (dopplerOn)
+    dopplerInputs[0].allocateForMaxBufferSize(Nmax);
+    dopplerInputs[1].allocateForMaxBufferSize(Nmax);
+    if (dopplerOn && dopplerEngine == DopplerEngine::SCATTER)
     {
         //doppler[0].free();
         //doppler[1].free();
-        doppler[0].allocate(dopplerMaxDistance, Nmax, 0.1f/*dopplerSpeedOfSound*/);
-        doppler[1].allocate(dopplerMaxDistance, Nmax, 0.1f/*dopplerSpeedOfSound*/);
+        doppler[0].allocate(dopplerMaxDistance, Nmax, minDopplerSpeedOfSound/*dopplerSpeedOfSound*/);
+        doppler[1].allocate(dopplerMaxDistance, Nmax, minDopplerSpeedOfSound/*dopplerSpeedOfSound*/);
     }
 }
 
@@ -783,19 +956,27 @@ void PlayableSoundSource::allocateForMaxBufferSize(const int N_max)
 //    return realTime;
 //}
 
-void PlayableSoundSource::setDopplerOn(const bool newDopplerOn, const float newSpeedOfSound)
+void PlayableSoundSource::setDopplerOn(const bool newDopplerOn, const float newSpeedOfSound, const DopplerEngine newEngine, const bool mono)
 {
     dopplerSpeedOfSound = newSpeedOfSound;
 	doppler[0].setSpeedOfSound(dopplerSpeedOfSound);
 	doppler[1].setSpeedOfSound(dopplerSpeedOfSound);
-	if (newDopplerOn != dopplerOn) {
-		if (newDopplerOn) {
-			doppler[0].allocate(dopplerMaxDistance, Nmax, 0.1f);
-			doppler[1].allocate(dopplerMaxDistance, Nmax, 0.1f);
-		} else {
-            doppler[0].free();
-            doppler[1].free();
-		}
+	// this is called from the audio thread for every block, so the memory is allocated and freed in the background, and only when the doppler effect changes.
+	// only the scatter engine needs memory of its own, freeing it is tried again while it is not in use, in case the last memory handed off was still being freed
+	const bool changed = newDopplerOn != dopplerOn || newEngine != dopplerEngine || mono != dopplerMono;
+	const bool scatter = newDopplerOn && newEngine == DopplerEngine::SCATTER;
+	if (changed && scatter) {
+		doppler[0].allocateInBackground(dopplerMaxDistance, Nmax, minDopplerSpeedOfSound);
+		doppler[1].allocateInBackground(dopplerMaxDistance, Nmax, minDopplerSpeedOfSound);
+	} else if (!scatter) {
+		doppler[0].freeInBackground();
+		doppler[1].freeInBackground();
+	}
+	if (changed) {
+		// the new state goes in first, so that the state of the doppler effect now in use is what gets reset
+		dopplerOn = newDopplerOn;
+		dopplerEngine = newEngine;
+		dopplerMono = mono;
 		// reset processing state of sound source
 //        for (auto& i : inputs)
 //            i.clear();
@@ -825,7 +1006,6 @@ void PlayableSoundSource::setDopplerOn(const bool newDopplerOn, const float newS
     //    HRIRChange = false;
     //    prevRAE = posRAE;
     //}
-    dopplerOn = newDopplerOn;
 }
 
 void PlayableSoundSource::setDopplerSampleRate(const float sampleRate) noexcept
@@ -850,20 +1030,32 @@ void PlayableSoundSource::resetProcessingState() noexcept
     {
         doppler[0].reset();
         doppler[1].reset();
+        dopplerInputs[0].reset();
+        dopplerInputs[1].reset();
     }
 //    for (auto& i : inputs)
 //        i.clear();
 //    newInputIndex = 0;
-    for (auto& x : inputBuffer)
-        x = 0;
-    inputBufferInPos = 0;
-    inputBufferOutPos = 0;
     HRIRChange = false;
     prevRAE = posRAE;
 }
 
-void PlayableSoundSource::processAudio(const float* in, const int N, float* out, const bool realTime)
+float PlayableSoundSource::earToSourceDistance(const int ch) const noexcept
+{
+    float sourceXYZ[3];
+    RAEtoXYZ(&posRAE[0], sourceXYZ);
+    float earXYZ[3];
+    const float earRAE[3] {sphereRad, static_cast<float>(ch == 0 ? earAzimuth : -earAzimuth), earElevation};
+    RAEtoXYZ(earRAE, earXYZ);
+    const float dx = sourceXYZ[0] - earXYZ[0];
+    const float dy = sourceXYZ[1] - earXYZ[1];
+    const float dz = sourceXYZ[2] - earXYZ[2];
+    return std::sqrt(dx*dx + dy*dy + dz*dz);
+}
+
+void PlayableSoundSource::processAudio(SourceInput& input, float* out, const bool realTime)
 {
+    const int N = input.getN();
     float* whichHRIRs = nullptr;
     float* whichHRIRScaling = nullptr;
     // if we had an HRIRChange update we gotta interpolate that hrir data for the blended output
@@ -874,21 +1066,8 @@ void PlayableSoundSource::processAudio(const float* in, const int N, float* out,
             whichHRIRs = &HRIRs[0];
             whichHRIRScaling = &HRIRScaling[0];
             // end of the positional interps (only one that needs computation for realtime)
-            interpolateHRIR(&posRAE[0], &HRIRs[2*numTimeSteps]);
-            // this pre-convolution normalization is required to get rid of the crackling in the quiet ear for close sources due to floating point addition inaccuracy
-            HRIRScaling[2] = HRIRScaling[3] = 0;
-            for (int n = 0; n < numTimeSteps; ++n) {
-                HRIRScaling[2] += std::abs(HRIRs[2*numTimeSteps+n]);
-                HRIRScaling[3] += std::abs(HRIRs[3*numTimeSteps+n]);
-            }
-            HRIRScaling[2] = 1.0/HRIRScaling[2];
-            HRIRScaling[3] = 1.0/HRIRScaling[3];
-            for (int n = 0; n < numTimeSteps; ++n) {
-                HRIRs[2*numTimeSteps+n] *= HRIRScaling[2];
-                HRIRs[3*numTimeSteps+n] *= HRIRScaling[3];
-            }
-            HRIRScaling[2] = 1.0/HRIRScaling[2];
-            HRIRScaling[3] = 1.0/HRIRScaling[3];
+            // (its pre-convolution normalization is required to get rid of the crackling in the quiet ear for close sources due to floating point addition inaccuracy)
+            interpolateHRIR(&posRAE[0], &HRIRs[2*numTimeSteps], &HRIRScaling[2]);
 		}
 		else {
 			// for non-realtime processing, we can go crazy and have each output sample be processed with a different blending position for nice smooth audio despite potentially fast moving source
@@ -906,21 +1085,7 @@ void PlayableSoundSource::processAudio(const float* in, const int N, float* out,
             whichHRIRScaling = &hqHRIRScaling[0];
             const int lastHRIR = numHRIRs-1;
             // end of the positional interps (only one that needs computation for realtime)
-            interpolateHRIR(&posRAE[0], &hqHRIRs[lastHRIR*2*numTimeSteps]);
-            // pre-convolution normalization
-            hqHRIRScaling[lastHRIR*2] = hqHRIRScaling[lastHRIR*2+1] = 0;
-            for (int n = 0; n < numTimeSteps; ++n) {
-                hqHRIRScaling[lastHRIR*2  ] += std::abs(hqHRIRs[ lastHRIR*2   *numTimeSteps+n]);
-                hqHRIRScaling[lastHRIR*2+1] += std::abs(hqHRIRs[(lastHRIR*2+1)*numTimeSteps+n]);
-            }
-            hqHRIRScaling[lastHRIR*2  ] = 1.0/hqHRIRScaling[lastHRIR*2  ];
-            hqHRIRScaling[lastHRIR*2+1] = 1.0/hqHRIRScaling[lastHRIR*2+1];
-            for (int n = 0; n < numTimeSteps; ++n) {
-                hqHRIRs[ lastHRIR*2   *numTimeSteps+n] *= hqHRIRScaling[lastHRIR*2  ];
-                hqHRIRs[(lastHRIR*2+1)*numTimeSteps+n] *= hqHRIRScaling[lastHRIR*2+1];
-            }
-            hqHRIRScaling[lastHRIR*2  ] = 1.0/hqHRIRScaling[lastHRIR*2  ];
-            hqHRIRScaling[lastHRIR*2+1] = 1.0/hqHRIRScaling[lastHRIR*2+1];
+            interpolateHRIR(&posRAE[0], &hqHRIRs[lastHRIR*2*numTimeSteps], &hqHRIRScaling[lastHRIR*2]);
             hqHRIRScaling[0] = HRIRScaling[0]; // load the first hrir pos scaling factors
             hqHRIRScaling[1] = HRIRScaling[1];
             // number of interps minus the endpoints which have already been interped!
@@ -944,21 +1109,7 @@ void PlayableSoundSource::processAudio(const float* in, const int N, float* out,
                 posXYZ[2] = i * factorZ + xyzCurrent[2];
                 // convert back to spherical
                 XYZtoRAE(&posXYZ[0], &pos_RAE[0]);
-                interpolateHRIR(pos_RAE, &hqHRIRs[i*2*numTimeSteps]);
-                // pre-convolution normalization
-                hqHRIRScaling[i*2] = hqHRIRScaling[i*2+1] = 0;
-                for (int n = 0; n < numTimeSteps; ++n) {
-                    hqHRIRScaling[i*2  ] += std::abs(hqHRIRs[ i*2   *numTimeSteps+n]);
-                    hqHRIRScaling[i*2+1] += std::abs(hqHRIRs[(i*2+1)*numTimeSteps+n]);
-                }
-                hqHRIRScaling[i*2  ] = 1.0/hqHRIRScaling[i*2  ];
-                hqHRIRScaling[i*2+1] = 1.0/hqHRIRScaling[i*2+1];
-                for (int n = 0; n < numTimeSteps; ++n) {
-                    hqHRIRs[ i*2   *numTimeSteps+n] *= hqHRIRScaling[i*2  ];
-                    hqHRIRs[(i*2+1)*numTimeSteps+n] *= hqHRIRScaling[i*2+1];
-                }
-                hqHRIRScaling[i*2  ] = 1.0/hqHRIRScaling[i*2  ];
-                hqHRIRScaling[i*2+1] = 1.0/hqHRIRScaling[i*2+1];
+                interpolateHRIR(pos_RAE, &hqHRIRs[i*2*numTimeSteps], &hqHRIRScaling[i*2]);
             }
         }
         // load the "current" hrir into the blended HRIRs and make "current" hrir the one for the next position, think that screwy stuff with the HRIR data is causing those rare fuzzes when the sources moves, still not sure what to do to fix it...
@@ -976,15 +1127,12 @@ void PlayableSoundSource::processAudio(const float* in, const int N, float* out,
             whichHRIRs[numTimeSteps+n] = HRIR      [numTimeSteps+n];
             HRIR      [numTimeSteps+n] = whichHRIRs[((numHRIRs-1)*2+1)*numTimeSteps+n];
         }
+        interleaveHRIRs(&HRIR[0], numTimeSteps, 1, &HRIRInterleaved[0]);
         // advance positional state
         pprevRAE = prevRAE;
         prevRAE = posRAE;
     } // end if HRIRChange
-    // load the current input
-	for (int n = 0; n < N; ++n) {
-		inputBuffer[inputBufferInPos] = in[n];
-		inputBufferInPos = (inputBufferInPos + 1) % inputBuffer.size();
-	}
+    // the current input was already loaded into the shared input history by SourceInput::load()
 
 //	// old input inserting
 //    inputs[newInputIndex].load(in, N);
@@ -1016,13 +1164,63 @@ void PlayableSoundSource::processAudio(const float* in, const int N, float* out,
 ////        }
 ////    }
 	
-    // allocate final output array
-    STACK_ARRAY(float, yfinal, N);
+    // the fractional delay doppler effect reads each ear's input from the delay line shared by all of the sources, and the ears convolve those instead of the shared input.
+    // in mono, one input delayed for the distance to the center of the head is read and convolved for both ears, the hrir gives it the interaural time difference
+    const bool dopplerBeforeConvolution = dopplerOn && dopplerEngine == DopplerEngine::FRACTIONAL_DELAY;
+    const bool monoDoppler = dopplerBeforeConvolution && dopplerMono;
+    const int numDopplerInputs = monoDoppler ? 1 : 2;
+    if (dopplerBeforeConvolution) {
+        STACK_ARRAY(float, delayedInput, N)
+        for (int ch = 0; ch < numDopplerInputs; ++ch) {
+            doppler[ch].process(monoDoppler ? posRAE[0] : earToSourceDistance(ch), N, input.getDopplerDelayLine(), delayedInput);
+            dopplerInputs[ch].load(delayedInput, N, input.getConvolutionEngine() == ConvolutionEngine::PARTITIONED_FFT);
+        }
+    }
+    const InputHistory* const earInputs[2] {dopplerBeforeConvolution ? &dopplerInputs[0] : &input,
+                                           dopplerBeforeConvolution ? &dopplerInputs[numDopplerInputs-1] : &input};
+    const bool fftEngine = input.getConvolutionEngine() == ConvolutionEngine::PARTITIONED_FFT;
+    // blending between more than two hrirs (non-realtime) is left to the time domain convolution
+    const bool useFFT = fftEngine && (!HRIRChange || numHRIRs == 2);
+    if (HRIRChange && !useFFT)
+        interleaveHRIRs(whichHRIRs, numTimeSteps, numHRIRs, &HRIRsInterleaved[0]);
+    if (useFFT) {
+        if (!HRIRSpectraValid) {
+            convolver.setFilter(0, HRIRChange ? &whichHRIRs[0] : &HRIR[0]);
+            convolver.setFilter(1, HRIRChange ? &whichHRIRs[numTimeSteps] : &HRIR[numTimeSteps]);
+        }
+        if (HRIRChange) {
+            convolver.setFilter(2, &whichHRIRs[2*numTimeSteps]);
+            convolver.setFilter(3, &whichHRIRs[3*numTimeSteps]);
+        }
+    }
+    
+    // allocate final output array for both ears
+    STACK_ARRAY(float, yfinal, 2*N);
+    STACK_ARRAY(float, yNext, N);
+    // the time domain convolution computes both ears together, so when the ears have their own inputs it is done once for each
+    if (!useFFT) {
+        const auto convolveBothEars = [&] (const InputHistory& in, float* yLeft, float* yRight)
+        {
+            if (HRIRChange)
+                convolveMirrored(in.getBuffer(), in.getOutPos(), in.getBufferSize(),
+                                 &HRIRsInterleaved[0], numTimeSteps, numHRIRs, &whichHRIRScaling[0],
+                                 yLeft, yRight, N);
+            else
+                convolveMirrored(in.getBuffer(), in.getOutPos(), in.getBufferSize(),
+                                 &HRIRInterleaved[0], numTimeSteps, &HRIRScaling[0],
+                                 yLeft, yRight, N);
+        };
+        if (dopplerBeforeConvolution && !monoDoppler) {
+            convolveBothEars(dopplerInputs[0], &yfinal[0], &yNext[0]);
+            convolveBothEars(dopplerInputs[1], &yNext[0], &yfinal[N]);
+        } else {
+            convolveBothEars(*earInputs[0], &yfinal[0], &yfinal[N]);
+        }
+    }
     // process for each ear
     for (int ch = 0; ch < 2; ++ch) {
-        // zero fill output array
-        for (int n = 0; n < N; ++n)
-            yfinal[n] = 0;
+        float* y = &yfinal[ch*N];
+        const ConvolverInput& convolverInput = earInputs[ch]->getConvolverInput();
             
         // blending hrirs in this buffer
         if (HRIRChange) {
@@ -1092,17 +1290,30 @@ void PlayableSoundSource::processAudio(const float* in, const int N, float* out,
             //        }
             //    }
             //}
-			convolve(&inputBuffer[0], inputBufferOutPos, inputBuffer.size(),
-					 &whichHRIRs[0], numTimeSteps, numHRIRs, &whichHRIRScaling[0], ch,
-				     &yfinal[0], N);
-            // advance the HRIR scaling stuff
-            HRIRScaling[0] = whichHRIRScaling[(numHRIRs-1)*2];
-            HRIRScaling[1] = whichHRIRScaling[(numHRIRs-1)*2+1];
+            if (useFFT) {
+                // crossfade from the current hrir's output to the next hrir's output over the buffer, same as convolve() does for two hrirs
+                convolver.process(convolverInput, ch, y);
+                convolver.process(convolverInput, 2+ch, &yNext[0]);
+                const float scale1 = whichHRIRScaling[ch];
+                const float scale2 = whichHRIRScaling[2+ch];
+                for (int n = 0; n < N; ++n) {
+                    const float hBlend = n / float(N);
+                    y[n] = y[n] * scale1 * (1-hBlend) + yNext[n] * scale2 * hBlend;
+                }
+            }
+            // advance the HRIR scaling stuff (after the last ear is done with the current scaling)
+            if (ch == 1) {
+                HRIRScaling[0] = whichHRIRScaling[(numHRIRs-1)*2];
+                HRIRScaling[1] = whichHRIRScaling[(numHRIRs-1)*2+1];
+            }
         } else { // no blending to do in this buffer as we are stationary
 
-			convolve(&inputBuffer[0], inputBufferOutPos, inputBuffer.size(), 
-				     &HRIR[ch*numTimeSteps], numTimeSteps, HRIRScaling[ch],
-				     &yfinal[0], N);
+            if (useFFT) {
+                convolver.process(convolverInput, ch, y);
+                const float scale = HRIRScaling[ch];
+                for (int n = 0; n < N; ++n)
+                    y[n] *= scale;
+            }
 
 //            // do convolutions for all the inputs that are needed to render this buffers output
 //            // note that begin and end indecies are refering to the previous buffer's indexing context, not the current buffer's
@@ -1132,26 +1343,11 @@ void PlayableSoundSource::processAudio(const float* in, const int N, float* out,
 //                    yfinal[n-beginIndex] += y[n] * HRIRScaling[ch];
 //            }
         }
-        // apply doppler effect
-        if (dopplerOn) {
+        // apply doppler effect (the fractional delay one was applied to the input)
+        if (dopplerOn && !dopplerBeforeConvolution) {
             STACK_ARRAY(float, yDoppler, N)
-            float sourceXYZ[3];
-            RAEtoXYZ(&posRAE[0], sourceXYZ);
-            float earXYZ[3];
-			const float earRAE[3] {sphereRad, static_cast<float>(ch == 0 ? earAzimuth : -earAzimuth), earElevation};
-			RAEtoXYZ(earRAE, earXYZ);
-            const float dx = sourceXYZ[0] - earXYZ[0];
-            const float dy = sourceXYZ[1] - earXYZ[1];
-            const float dz = sourceXYZ[2] - earXYZ[2];
-            const float earToSourceDistance = std::sqrt(dx*dx + dy*dy + dz*dz);
-            if (earToSourceDistance > dopplerMaxDistance) {
-                // shouldn't happen that often, so reallocing here when necessary shouldn't cause any big problems
-                dopplerMaxDistance = earToSourceDistance * 2;
-                doppler[0].allocate(dopplerMaxDistance, Nmax, 0.1f/*dopplerSpeedOfSound*/);
-                doppler[1].allocate(dopplerMaxDistance, Nmax, 0.1f/*dopplerSpeedOfSound*/);
-                //dopplerMaxDistanceChanged = true;
-            }
-            doppler[ch].process(earToSourceDistance, N, yfinal, yDoppler);
+            // the doppler effect grows its memory in the background if the source goes further away than it holds
+            doppler[ch].process(earToSourceDistance(ch), N, y, yDoppler);
             // package each channel's output into one dual-channel array
 			for (int n = 0; n < N; ++n)
 				out[ch*N + n] += yDoppler[n];
@@ -1159,60 +1355,345 @@ void PlayableSoundSource::processAudio(const float* in, const int N, float* out,
 		else { // no doppler effect
 			// package each channel's output into one dual-channel array
 			for (int n = 0; n < N; ++n)
-				out[ch*N + n] += yfinal[n];
+				out[ch*N + n] += y[n];
         }
     } // end for each channel
-	inputBufferOutPos = (inputBufferOutPos + N) % inputBuffer.size();
+    for (int ch = 0; dopplerBeforeConvolution && ch < numDopplerInputs; ++ch)
+        dopplerInputs[ch].advance();
+    // keep track of whether the fft engine's filters match the (possibly just updated) HRIR
+    if (useFFT) {
+        if (HRIRChange) {
+            convolver.copyFilter(2, 0);
+            convolver.copyFilter(3, 1);
+        }
+        HRIRSpectraValid = true;
+    } else if (HRIRChange) {
+        HRIRSpectraValid = false;
+    }
+    if (HRIRChange)
+        ++HRIRVersion;
     prevHRIRChange = HRIRChange;
     // set the state of movement so that the next buffer is stationary, which may change if we get an updated position from the gl side
     HRIRChange = false;
 }
 
-// the global hrir data that gets one instance across multiple plugin instances, this just references the one instance defined in PluginProcessor.cpp
-extern float***** HRIRdata;
-extern float**** HRIRdataPoles;
+/***** StationarySources *****/
+void StationarySources::allocate(const int maxNumSources)
+{
+    sources.reserve(maxNumSources);
+    prevSources.reserve(maxNumSources);
+    convolver.allocate(numTimeSteps, convolutionPartitionSize, 2);
+    HRIRSpectraValid = false;
+}
 
-// compacted (one azimuth side provided) with pole data version
-void PlayableSoundSource::interpolateHRIR(const float* rae, float* hrir) const noexcept
+void StationarySources::clear() noexcept
 {
-    // get the inner + outer rad,azi,ele indicies that define the 3d region bounded by the hrtf/dvf sampling resolution that the source is currently located in
-    const int innerRadiusIndex = std::max(0, std::min((int)((std::log(rae[0])-std::log(distanceBegin))/std::log(distanceEnd/distanceBegin)*(numDistanceSteps-1)), numDistanceSteps-2));//-1);
-    const int outerRadiusIndex = innerRadiusIndex+1;// std::min(innerRadiusIndex+1, numDistanceSteps-1);
+    sources.clear();
+}
+
+bool StationarySources::add(PlayableSoundSource& source) noexcept
+{
+    // moving sources blend between hrirs and the doppler effect is applied after the convolution, so both need their own processing
+    if (source.HRIRChange || source.dopplerOn || sources.size() == sources.capacity())
+        return false;
+    sources.emplace_back(&source, source.HRIRVersion);
+    // the same bookkeeping PlayableSoundSource::processAudio() does for a stationary buffer
+    source.prevHRIRChange = false;
+    return true;
+}
+
+void StationarySources::processAudio(const SourceInput& input, float* out)
+{
+    if (sources.size() == 0) {
+        prevSources.clear();
+        return;
+    }
+    // resum the hrirs only if a source was added, removed, or changed position since the previous buffer
+    if (sources != prevSources) {
+        for (auto& x : HRIR)
+            x = 0;
+        for (const auto& s : sources)
+            for (int ch = 0; ch < 2; ++ch)
+                for (int n = 0; n < numTimeSteps; ++n)
+                    HRIR[ch*numTimeSteps+n] += s.first->HRIR[ch*numTimeSteps+n] * s.first->HRIRScaling[ch];
+        // pre-convolution normalization
+        normalizeHRIR(&HRIR[0], &HRIRScaling[0]);
+        interleaveHRIRs(&HRIR[0], numTimeSteps, 1, &HRIRInterleaved[0]);
+        prevSources = sources;
+        HRIRSpectraValid = false;
+    }
+    const int N = input.getN();
+    const bool useFFT = input.getConvolutionEngine() == ConvolutionEngine::PARTITIONED_FFT;
+    if (useFFT && !HRIRSpectraValid) {
+        convolver.setFilter(0, &HRIR[0]);
+        convolver.setFilter(1, &HRIR[numTimeSteps]);
+        HRIRSpectraValid = true;
+    }
+    STACK_ARRAY(float, y, 2*N);
+    if (useFFT) {
+        for (int ch = 0; ch < 2; ++ch) {
+            convolver.process(input.getConvolverInput(), ch, &y[ch*N]);
+            for (int n = 0; n < N; ++n)
+                y[ch*N + n] *= HRIRScaling[ch];
+        }
+    } else {
+        convolveMirrored(input.getBuffer(), input.getOutPos(), input.getBufferSize(),
+                         &HRIRInterleaved[0], numTimeSteps, &HRIRScaling[0],
+                         &y[0], &y[N], N);
+    }
+    for (int n = 0; n < 2*N; ++n)
+        out[n] += y[n];
+}
+
+// the angular grid steps of the hrir data and their reciprocals
+static constexpr float twoPi = 2*M_PI;
+static constexpr float azimuthStep = twoPi/numAzimuthSteps, oneOverAzimuthStep = numAzimuthSteps/twoPi;
+static constexpr float elevationStep = M_PI/numElevationSteps, oneOverElevationStep = numElevationSteps/M_PI;
+
+// the region of the hrir data's grid that a position is in (see findHRIRNeighbors()), and the azimuth reversed for indexing the data
+static std::array<int, 5> getHRIRCell(const float* rae, float& revAzi) noexcept
+{
+    const int innerRadiusIndex = radialGrid.innerIndex(rae[0]);
     
-    const int lowerElevationIndex = std::max(0, std::min((int)std::floor(rae[2]/M_PI*numElevationSteps), numElevationSteps-1));
+    const int lowerElevationIndex = std::max(0, std::min((int)(rae[2]*oneOverElevationStep), numElevationSteps-1)); // truncating works as flooring with the clamp to 0
     const int upperElevationIndex = lowerElevationIndex+1;
     
-    const float revAzi = std::fmod(4*M_PI-rae[1], 2*M_PI); // fix reversed azimuth indexing with hrir array's, this caused lowerAzimuthIndex = -1 without fmod
-    int lowerAzimuthIndex = std::min((int)std::floor(revAzi/(2*M_PI)*numAzimuthSteps), numAzimuthSteps-1);
-    int upperAzimuthIndex = (lowerAzimuthIndex+1) % numAzimuthSteps;
-    
-    // inner/outer surface radius values
-    const float rIn  = distanceBegin*std::pow(distanceEnd/distanceBegin, ((float)innerRadiusIndex)/(numDistanceSteps-1));
-    const float rOut = distanceBegin*std::pow(distanceEnd/distanceBegin, ((float)outerRadiusIndex)/(numDistanceSteps-1));
+    // fix reversed azimuth indexing with hrir array's, wrapping into [0, 2pi) (which caused lowerAzimuthIndex = -1 without it)
+    revAzi = twoPi-rae[1];
+    if (revAzi >= twoPi)
+        revAzi -= twoPi;
+    else if (revAzi < 0)
+        revAzi += twoPi;
+    const int lowerAzimuthIndex = std::min((int)(revAzi*oneOverAzimuthStep), numAzimuthSteps-1);
+    const int upperAzimuthIndex = lowerAzimuthIndex+1 < numAzimuthSteps ? lowerAzimuthIndex+1 : 0;
     
     // upper/lower azimuth values
-    const float aP = ((float)(upperAzimuthIndex))*(2*M_PI)/numAzimuthSteps;
-    const float aM = ((float)(lowerAzimuthIndex))*(2*M_PI)/numAzimuthSteps;
+    const float aP = upperAzimuthIndex*azimuthStep;
+    const float aM = lowerAzimuthIndex*azimuthStep;
     
     // upper/lower elevation values
-    const float eM = ((float)lowerElevationIndex)*M_PI/numElevationSteps;
-    const float eP = ((float)upperElevationIndex)*M_PI/numElevationSteps;
+    const float eM = lowerElevationIndex*elevationStep;
+    const float eP = upperElevationIndex*elevationStep;
+    
+    // which side of the region the nearby azimuth/elevation neighbors are on
+    const bool nAziUp = (aP > aM ? aP-revAzi : 2.0*M_PI-revAzi) <= revAzi-aM;
+    const bool nEleUp = eP-rae[2] <= rae[2]-eM;
+    return {{innerRadiusIndex, lowerAzimuthIndex, lowerElevationIndex, nAziUp, nEleUp}};
+}
+
+void PlayableSoundSource::prefetchHRIRs(const std::array<float, 3>& rae) noexcept
+{
+    if (!HRIRdata)
+        return;
+    float revAzi;
+    const std::array<int, 5> cell = getHRIRCell(&rae[0], revAzi);
+    if ((HRIRNeighborCache.numNeighbors > 0 && HRIRNeighborCache.cell == cell)
+        || std::find(prefetchedCells.begin(), prefetchedCells.end(), cell) != prefetchedCells.end())
+        return;
+    prefetchedCells[nextPrefetchedCell] = cell;
+    nextPrefetchedCell = (nextPrefetchedCell + 1) % prefetchedCells.size();
+    HRIRNeighbors neighbors;
+    findHRIRNeighbors(cell, neighbors);
+    for (int i = 0; i < neighbors.numNeighbors; ++i)
+        HRIRdata->prefetch(neighbors.rows[i]);
+}
+
+// compacted (one azimuth side provided) with pole data version
+void PlayableSoundSource::interpolateHRIR(const float* rae, float* hrir, float* scaling) const noexcept
+{
+    // get the inner + outer rad,azi,ele indicies that define the 3d region bounded by the hrtf/dvf sampling resolution that the source is currently located in
+    float revAzi;
+    const std::array<int, 5> cell = getHRIRCell(rae, revAzi);
+    const int innerRadiusIndex = cell[0];
+    const int lowerAzimuthIndex = cell[1];
+    const int lowerElevationIndex = cell[2];
+    const bool nAziUp = cell[3];
+    const bool nEleUp = cell[4];
+    
+    // inner surface radius value
+    const float rIn = radialGrid.radius[innerRadiusIndex];
+    
+    // lower azimuth/elevation values
+    const float aM = lowerAzimuthIndex*azimuthStep;
+    const float eM = lowerElevationIndex*elevationStep;
     
     // for making close/far more loud/quiet
-    const float intensity_factor = 0.1 / std::pow(rae[0], 0.5);
+    const float intensity_factor = 0.1f / std::sqrt(rae[0]);
     
-    const float mu3 = 0.5*intensity_factor*std::min((rae[0]-rIn)/(rOut-rIn), 1.0f); // scaled by 1/2*intensity_factor here instead of for each sample below
+    const float mu3 = 0.5f*intensity_factor*std::min((rae[0]-rIn)*radialGrid.oneOverStep[innerRadiusIndex], 1.0f); // scaled by 1/2*intensity_factor here instead of for each sample below
     
     // interpolate along azimuth edges
-    const float mu1_01 = (rae[2]-eM)*numElevationSteps/M_PI; // should be btw 0 and 1
+    const float mu1_01 = (rae[2]-eM)*oneOverElevationStep; // should be btw 0 and 1
     const float mu1 = mu1_01 + 2;                            // should be btw 2 and 3
     const float nmu1 = std::abs(2.5-mu1); // should be 0 when source is dead center in interp region, 0.5 when source is on boarder
     
     // interpolate along elevation edges
-    const float mu2_01 = (revAzi-aM)*numAzimuthSteps/(2.0*M_PI); // should be btw 0 and 1
+    const float mu2_01 = (revAzi-aM)*oneOverAzimuthStep; // should be btw 0 and 1
     const float mu2 = mu2_01 + 2;                                // should be btw 2 and 3
     const float nmu2 = std::abs(2.5-mu2); // should be 0 when source is dead center in interp region, 0.5 when source is on boarder
     
+    const float mu1n = nEleUp ? mu1 - 1 : mu1 + 1;
+    const float mu2n = nAziUp ? mu2 - 1 : mu2 + 1;
+    
+    // the neighboring hrirs only change when the source moves into another region (or to the other side of one), within a region only their weights change
+    const HRIRNeighbors& cache = HRIRNeighborCache;
+    if (cache.numNeighbors == 0 || cache.cell != cell)
+        findHRIRNeighbors(cell, HRIRNeighborCache);
+    
+    // mu1's are for azi interp
+    const float mu1_1 = mu1 - 1;
+    const float mu1_2 = mu1 - 2;
+    const float mu1_3 = mu1 - 3;
+    const float mu1_4 = mu1 - 4;
+    const float mu1n_1 = mu1n - 1;
+    const float mu1n_2 = mu1n - 2;
+    const float mu1n_3 = mu1n - 3;
+    const float mu1n_4 = mu1n - 4;
+    
+    // mu2's are for ele interp
+    const float mu2_1 = mu2 - 1;
+    const float mu2_2 = mu2 - 2;
+    const float mu2_3 = mu2 - 3;
+    const float mu2_4 = mu2 - 4;
+    const float mu2n_1 = mu2n - 1;
+    const float mu2n_2 = mu2n - 2;
+    const float mu2n_3 = mu2n - 3;
+    const float mu2n_4 = mu2n - 4;
+    
+    const float oneminus_nmu1 = 1.0 - nmu1;
+    const float oneminus_nmu2 = 1.0 - nmu2;
+    const float oneminus_mu3 = 0.5*intensity_factor - mu3;//1.0 - mu3; // scaled by 1/2*intensity_factor here instead of for each sample below
+    const float oneminus_mu1_01 = 1.0 - mu1_01;
+    const float oneminus_mu2_01 = 1.0 - mu2_01;
+    
+    const float a1 = mu1_2 * mu1_3 * mu1_4 * -0.1666666666666666667;
+    const float a2 = mu1_1 * mu1_3 * mu1_4 * 0.5;
+    const float a3 = mu1_1 * mu1_2 * mu1_4 * -0.5;
+    const float a4 = mu1_1 * mu1_2 * mu1_3 * 0.1666666666666666667;
+    const float na1 = mu1n_2 * mu1n_3 * mu1n_4 * -0.1666666666666666667;
+    const float na2 = mu1n_1 * mu1n_3 * mu1n_4 * 0.5;
+    const float na3 = mu1n_1 * mu1n_2 * mu1n_4 * -0.5;
+    const float na4 = mu1n_1 * mu1n_2 * mu1n_3 * 0.1666666666666666667;
+    
+    const float e1 = mu2_2 * mu2_3 * mu2_4 * -0.1666666666666666667;
+    const float e2 = mu2_1 * mu2_3 * mu2_4 * 0.5;
+    const float e3 = mu2_1 * mu2_2 * mu2_4 * -0.5;
+    const float e4 = mu2_1 * mu2_2 * mu2_3 * 0.1666666666666666667;
+    const float ne1 = mu2n_2 * mu2n_3 * mu2n_4 * -0.1666666666666666667;
+    const float ne2 = mu2n_1 * mu2n_3 * mu2n_4 * 0.5;
+    const float ne3 = mu2n_1 * mu2n_2 * mu2n_4 * -0.5;
+    const float ne4 = mu2n_1 * mu2n_2 * mu2n_3 * 0.1666666666666666667;
+    
+    // the hrir is a weighted sum of the 64 neighboring hrirs found by findHRIRNeighbors(), whose weights are the products of the weights of each stage of the interpolation:
+    // hrir = mu3*netOut + (1-mu3)*netIn, net(In/Out) = (1-mu1_01)*(Em) + mu1_01*(Ep) + (1-mu2_01)*(Am) + mu2_01*(Ap),
+    // (Ap/Am) = nmu1*(na1..4 nearby hrirs) + (1-nmu1)*(a1..4 in-region hrirs), (Ep/Em) = nmu2*(ne1..4 nearby hrirs) + (1-nmu2)*(e1..4 in-region hrirs).
+    // many neighbors are the same hrir, so the weights are summed up per distinct hrir first.
+    // (in-region/nearby)(inner/outer)(azimuth/elevation)(plus/minus)
+    const float inAp  = oneminus_mu3 * mu2_01,  inAm  = oneminus_mu3 * oneminus_mu2_01,
+                outAp = mu3 * mu2_01,           outAm = mu3 * oneminus_mu2_01,
+                inEp  = oneminus_mu3 * mu1_01,  inEm  = oneminus_mu3 * oneminus_mu1_01,
+                outEp = mu3 * mu1_01,           outEm = mu3 * oneminus_mu1_01;
+    const float nA[4] = {nmu1*na1, nmu1*na2, nmu1*na3, nmu1*na4};
+    const float  A[4] = {oneminus_nmu1*a1, oneminus_nmu1*a2, oneminus_nmu1*a3, oneminus_nmu1*a4};
+    const float nE[4] = {nmu2*ne1, nmu2*ne2, nmu2*ne3, nmu2*ne4};
+    const float  E[4] = {oneminus_nmu2*e1, oneminus_nmu2*e2, oneminus_nmu2*e3, oneminus_nmu2*e4};
+    
+    const float stages[8] = {inAp, inAm, outAp, outAm, inEp, inEm, outEp, outEm};
+    const float* lagrange[4] = {nA, A, nE, E};
+    std::array<float, 64> neighborWeights;
+    for (int i = 0; i < cache.numNeighbors; ++i)
+        neighborWeights[i] = 0;
+    for (int group = 0; group < 16; ++group) { // 16 groups of 4 terms, each group is a stage weight times the 4 weights of the nearby or in-region lagrange interpolation
+        const float stage = stages[group/2];
+        const float* l = lagrange[(group/8)*2 + group%2];
+        for (int k = 0; k < 4; ++k)
+            neighborWeights[cache.terms[group*4+k]] += stage * l[k];
+    }
+    
+    // with distance factorized hrir data the neighbors are correction filters for the far field hrirs, and since the inner and outer distance neighbors share their far field hrirs
+    // the radial interpolation happens by summing up their (weighted) correction filters per distinct far field hrir, which then only gets filtered once per channel
+    if (const int numTaps = HRIRdata->getNumCorrectionTaps()) {
+        struct FarFieldNeighbor { const float* row; int baseCh; std::array<float, 2*HRIRTableFileMaxCorrectionTaps> correction; };
+        std::array<FarFieldNeighbor, 64> farFieldNeighbors;
+        int numFarFieldNeighbors = 0;
+        for (int i = 0; i < cache.numNeighbors; ++i) {
+            const float* farField = HRIRdata->farField(cache.rows[i]);
+            const int baseCh = cache.baseChs[i];
+            int j = 0;
+            while (j < numFarFieldNeighbors && (farFieldNeighbors[j].row != farField || farFieldNeighbors[j].baseCh != baseCh))
+                ++j;
+            if (j == numFarFieldNeighbors) {
+                farFieldNeighbors[j].row = farField;
+                farFieldNeighbors[j].baseCh = baseCh;
+                farFieldNeighbors[j].correction.fill(0);
+                ++numFarFieldNeighbors;
+            }
+            for (int ch = 0; ch < 2; ++ch) {
+                const float w = neighborWeights[i];
+                for (int t = 0; t < numTaps; ++t)
+                    farFieldNeighbors[j].correction[ch*numTaps+t] += w * cache.rows[i][(baseCh ^ ch)*numTaps + t];
+            }
+        }
+        for (int ch = 0; ch < 2; ++ch) {
+            float* h = &hrir[ch*numTimeSteps];
+            for (int n = 0; n < numTimeSteps; ++n)
+                h[n] = 0;
+            for (int j = 0; j < numFarFieldNeighbors; ++j) {
+                const float* x = &farFieldNeighbors[j].row[(farFieldNeighbors[j].baseCh ^ ch) * numTimeSteps];
+                const float* c = &farFieldNeighbors[j].correction[ch*numTaps];
+                for (int t = 0; t < numTaps; ++t)
+                    for (int n = t; n < numTimeSteps; ++n)
+                        h[n] += c[t] * x[n-t];
+            }
+        }
+        normalizeHRIR(hrir, scaling);
+        return;
+    }
+    
+    // sum the weighted neighbors for each channel (the right channel is each neighbor's other channel).
+    // with compressed hrir data that sums the neighbors' weights of the basis hrirs, and the hrir is only reconstructed from the basis once at the end.
+    const float* basis = HRIRdata->getBasis();
+    const int size = HRIRdata->getChannelSize();
+    STACK_ARRAY(float, weights, size);
+    for (int ch = 0; ch < 2; ++ch) {
+        float* sum = basis ? &weights[0] : &hrir[ch*numTimeSteps];
+        for (int k = 0; k < size; ++k)
+            sum[k] = 0;
+        for (int i = 0; i < cache.numNeighbors; ++i) {
+            const float* x = &cache.rows[i][(cache.baseChs[i] ^ ch) * size];
+            const float w = neighborWeights[i];
+            for (int k = 0; k < size; ++k)
+                sum[k] += w * x[k];
+        }
+        if (basis) {
+            float* h = &hrir[ch*numTimeSteps];
+            for (int n = 0; n < numTimeSteps; ++n)
+                h[n] = 0;
+            for (int k = 0; k < size; ++k) {
+                const float* b = &basis[k*numTimeSteps];
+                const float w = weights[k];
+                for (int n = 0; n < numTimeSteps; ++n)
+                    h[n] += w * b[n];
+            }
+        }
+    }
+    // normalized by its actual L1 norm, the same as the stationary sources' summed hrirs are
+    normalizeHRIR(hrir, scaling);
+}
+
+// finds the distinct neighboring hrirs that interpolateHRIR() sums for a source in the region cell = {inner radius index, lower azimuth index, lower elevation index, nAziUp, nEleUp},
+// and which of them each of the 64 terms of the interpolation weights
+void PlayableSoundSource::findHRIRNeighbors(const std::array<int, 5>& cell, HRIRNeighbors& neighbors) const noexcept
+{
+    const int innerRadiusIndex = cell[0];
+    const int outerRadiusIndex = innerRadiusIndex+1;
+    int lowerAzimuthIndex = cell[1];
+    int upperAzimuthIndex = lowerAzimuthIndex+1 < numAzimuthSteps ? lowerAzimuthIndex+1 : 0;
+    const int lowerElevationIndex = cell[2];
+    const int upperElevationIndex = lowerElevationIndex+1;
+    const bool nAziUp = cell[3];
+    const bool nEleUp = cell[4];
+    
     // variables for bounds wrapping surrounding data
     int uAzip1 = upperAzimuthIndex+1;
     int lAzim1 = lowerAzimuthIndex-1;
@@ -1234,22 +1715,9 @@ void PlayableSoundSource::interpolateHRIR(const float* rae, float* hrir) const n
         lElem1Flip = true;
     }
     
-    int nAzi2, nEle2;  // neighboring azi/ele indices
-    bool nAziUp, nEleUp;
-    if ((aP > aM ? aP-revAzi : 2.0*M_PI-revAzi) > revAzi-aM) {
-        nAzi2 = lowerAzimuthIndex-2;
-        nAziUp = false;
-    } else {
-        nAzi2 = upperAzimuthIndex+2;
-        nAziUp = true;
-    }
-    if (eP-rae[2] > rae[2]-eM) {
-        nEle2 = lowerElevationIndex-2;
-        nEleUp = false;
-    } else {
-        nEle2 = upperElevationIndex+2;
-        nEleUp = true;
-    }
+    // neighboring azi/ele indices
+    int nAzi2 = nAziUp ? upperAzimuthIndex+2 : lowerAzimuthIndex-2;
+    int nEle2 = nEleUp ? upperElevationIndex+2 : lowerElevationIndex-2;
     
     if (nAzi2 > numAzimuthSteps-1)
         nAzi2 -= numAzimuthSteps;
@@ -1292,22 +1760,22 @@ void PlayableSoundSource::interpolateHRIR(const float* rae, float* hrir) const n
     }
     
     // i like things that are difficult to understand (see below, they follow the same pattern as the original interpolateHRIR())
-    float **niRuAE1, **niRuAE2, **niRuAE3, **niRuAE4,
-           **iRuAE1,  **iRuAE2,  **iRuAE3,  **iRuAE4,
-          **niRlAE1, **niRlAE2, **niRlAE3, **niRlAE4,
-           **iRlAE1,  **iRlAE2,  **iRlAE3,  **iRlAE4,
-          **noRuAE1, **noRuAE2, **noRuAE3, **noRuAE4,
-           **oRuAE1,  **oRuAE2,  **oRuAE3,  **oRuAE4,
-          **noRlAE1, **noRlAE2, **noRlAE3, **noRlAE4,
-           **oRlAE1,  **oRlAE2,  **oRlAE3,  **oRlAE4,
-          **niRA1uE, **niRA2uE, **niRA3uE, **niRA4uE,
-           **iRA1uE,  **iRA2uE,  **iRA3uE,  **iRA4uE,
-          **niRA1lE, **niRA2lE, **niRA3lE, **niRA4lE,
-           **iRA1lE,  **iRA2lE,  **iRA3lE,  **iRA4lE,
-          **noRA1uE, **noRA2uE, **noRA3uE, **noRA4uE,
-           **oRA1uE,  **oRA2uE,  **oRA3uE,  **oRA4uE,
-          **noRA1lE, **noRA2lE, **noRA3lE, **noRA4lE,
-           **oRA1lE,  **oRA2lE,  **oRA3lE,  **oRA4lE;
+    const float *niRuAE1,  *niRuAE2,  *niRuAE3,  *niRuAE4,
+                 *iRuAE1,   *iRuAE2,   *iRuAE3,   *iRuAE4,
+                *niRlAE1,  *niRlAE2,  *niRlAE3,  *niRlAE4,
+                 *iRlAE1,   *iRlAE2,   *iRlAE3,   *iRlAE4,
+                *noRuAE1,  *noRuAE2,  *noRuAE3,  *noRuAE4,
+                 *oRuAE1,   *oRuAE2,   *oRuAE3,   *oRuAE4,
+                *noRlAE1,  *noRlAE2,  *noRlAE3,  *noRlAE4,
+                 *oRlAE1,   *oRlAE2,   *oRlAE3,   *oRlAE4,
+                *niRA1uE,  *niRA2uE,  *niRA3uE,  *niRA4uE,
+                 *iRA1uE,   *iRA2uE,   *iRA3uE,   *iRA4uE,
+                *niRA1lE,  *niRA2lE,  *niRA3lE,  *niRA4lE,
+                 *iRA1lE,   *iRA2lE,   *iRA3lE,   *iRA4lE,
+                *noRA1uE,  *noRA2uE,  *noRA3uE,  *noRA4uE,
+                 *oRA1uE,   *oRA2uE,   *oRA3uE,   *oRA4uE,
+                *noRA1lE,  *noRA2lE,  *noRA3lE,  *noRA4lE,
+                 *oRA1lE,   *oRA2lE,   *oRA3lE,   *oRA4lE;
     
     // need these cuz bounds wrapped ele indecies can flip their channels or at least the order of the 1234 matters depending on n(Ele/Azi)Up
     int nuAE1BaseCh, nuAE2BaseCh, nuAE3BaseCh, nuAE4BaseCh,
@@ -1324,268 +1792,262 @@ void PlayableSoundSource::interpolateHRIR(const float* rae, float* hrir) const n
     //const int lAzim1EleFlipped        = numAzimuthSteps-(lAzim1           +numAzimuthSteps/2);
     //const int nAzi2EleFlipped         = numAzimuthSteps-(nAzi2            +numAzimuthSteps/2);
     
-    float mu1n;
     if (nEleUp) {
-        mu1n = mu1 - 1;
         if (lowerElevationIndex == 0) {
-            niRuAE1 = niRlAE1 = HRIRdataPoles[innerRadiusIndex][0];
-            noRuAE1 = noRlAE1 = HRIRdataPoles[outerRadiusIndex][0];
+            niRuAE1 = niRlAE1 = HRIRdata->pole(innerRadiusIndex, 0);
+            noRuAE1 = noRlAE1 = HRIRdata->pole(outerRadiusIndex, 0);
             nuAE1BaseCh = nlAE1BaseCh = 0;
         } else {
-            niRuAE1 = HRIRdata[innerRadiusIndex][upperAzimuthIndex][lowerElevationIndex-1];
-            noRuAE1 = HRIRdata[outerRadiusIndex][upperAzimuthIndex][lowerElevationIndex-1];
-            niRlAE1 = HRIRdata[innerRadiusIndex][lowerAzimuthIndex][lowerElevationIndex-1];
-            noRlAE1 = HRIRdata[outerRadiusIndex][lowerAzimuthIndex][lowerElevationIndex-1];
+            niRuAE1 = HRIRdata->row(innerRadiusIndex, upperAzimuthIndex, lowerElevationIndex);
+            noRuAE1 = HRIRdata->row(outerRadiusIndex, upperAzimuthIndex, lowerElevationIndex);
+            niRlAE1 = HRIRdata->row(innerRadiusIndex, lowerAzimuthIndex, lowerElevationIndex);
+            noRlAE1 = HRIRdata->row(outerRadiusIndex, lowerAzimuthIndex, lowerElevationIndex);
             nuAE1BaseCh = uAziBaseCh;
             nlAE1BaseCh = lAziBaseCh;
         }
         if (upperElevationIndex == numElevationSteps) {
-            niRuAE2 = niRlAE2 = HRIRdataPoles[innerRadiusIndex][1];
-            noRuAE2 = noRlAE2 = HRIRdataPoles[outerRadiusIndex][1];
+            niRuAE2 = niRlAE2 = HRIRdata->pole(innerRadiusIndex, 1);
+            noRuAE2 = noRlAE2 = HRIRdata->pole(outerRadiusIndex, 1);
             nuAE2BaseCh = nlAE2BaseCh = 0;
         } else {
-            niRuAE2 = HRIRdata[innerRadiusIndex][upperAzimuthIndex][upperElevationIndex-1];
-            noRuAE2 = HRIRdata[outerRadiusIndex][upperAzimuthIndex][upperElevationIndex-1];
-            niRlAE2 = HRIRdata[innerRadiusIndex][lowerAzimuthIndex][upperElevationIndex-1];
-            noRlAE2 = HRIRdata[outerRadiusIndex][lowerAzimuthIndex][upperElevationIndex-1];
+            niRuAE2 = HRIRdata->row(innerRadiusIndex, upperAzimuthIndex, upperElevationIndex);
+            noRuAE2 = HRIRdata->row(outerRadiusIndex, upperAzimuthIndex, upperElevationIndex);
+            niRlAE2 = HRIRdata->row(innerRadiusIndex, lowerAzimuthIndex, upperElevationIndex);
+            noRlAE2 = HRIRdata->row(outerRadiusIndex, lowerAzimuthIndex, upperElevationIndex);
             nuAE2BaseCh = uAziBaseCh;
             nlAE2BaseCh = lAziBaseCh;
         }
         if (uElep1Flip) {
-            niRuAE3 = HRIRdata[innerRadiusIndex][upperAziIndexEleFlipped][uElep1-1];
-            noRuAE3 = HRIRdata[outerRadiusIndex][upperAziIndexEleFlipped][uElep1-1];
-            niRlAE3 = HRIRdata[innerRadiusIndex][lowerAziIndexEleFlipped][uElep1-1];
-            noRlAE3 = HRIRdata[outerRadiusIndex][lowerAziIndexEleFlipped][uElep1-1];
+            niRuAE3 = HRIRdata->row(innerRadiusIndex, upperAziIndexEleFlipped, uElep1);
+            noRuAE3 = HRIRdata->row(outerRadiusIndex, upperAziIndexEleFlipped, uElep1);
+            niRlAE3 = HRIRdata->row(innerRadiusIndex, lowerAziIndexEleFlipped, uElep1);
+            noRlAE3 = HRIRdata->row(outerRadiusIndex, lowerAziIndexEleFlipped, uElep1);
             nuAE3BaseCh = (uAziBaseCh + 1) % 2;
             nlAE3BaseCh = (lAziBaseCh + 1) % 2;
         } else if (uElep1 == numElevationSteps) {
-            niRuAE3 = niRlAE3 = HRIRdataPoles[innerRadiusIndex][1];
-            noRuAE3 = noRlAE3 = HRIRdataPoles[outerRadiusIndex][1];
+            niRuAE3 = niRlAE3 = HRIRdata->pole(innerRadiusIndex, 1);
+            noRuAE3 = noRlAE3 = HRIRdata->pole(outerRadiusIndex, 1);
             nuAE3BaseCh = nlAE3BaseCh = 0;
         } else {
-            niRuAE3 = HRIRdata[innerRadiusIndex][upperAzimuthIndex][uElep1-1];
-            noRuAE3 = HRIRdata[outerRadiusIndex][upperAzimuthIndex][uElep1-1];
-            niRlAE3 = HRIRdata[innerRadiusIndex][lowerAzimuthIndex][uElep1-1];
-            noRlAE3 = HRIRdata[outerRadiusIndex][lowerAzimuthIndex][uElep1-1];
+            niRuAE3 = HRIRdata->row(innerRadiusIndex, upperAzimuthIndex, uElep1);
+            noRuAE3 = HRIRdata->row(outerRadiusIndex, upperAzimuthIndex, uElep1);
+            niRlAE3 = HRIRdata->row(innerRadiusIndex, lowerAzimuthIndex, uElep1);
+            noRlAE3 = HRIRdata->row(outerRadiusIndex, lowerAzimuthIndex, uElep1);
             nuAE3BaseCh = uAziBaseCh;
             nlAE3BaseCh = lAziBaseCh;
         }
         if (nEleFlip) {
-            niRuAE4 = HRIRdata[innerRadiusIndex][upperAziIndexEleFlipped][nEle2-1];
-            noRuAE4 = HRIRdata[outerRadiusIndex][upperAziIndexEleFlipped][nEle2-1];
-            niRlAE4 = HRIRdata[innerRadiusIndex][lowerAziIndexEleFlipped][nEle2-1];
-            noRlAE4 = HRIRdata[outerRadiusIndex][lowerAziIndexEleFlipped][nEle2-1];
+            niRuAE4 = HRIRdata->row(innerRadiusIndex, upperAziIndexEleFlipped, nEle2);
+            noRuAE4 = HRIRdata->row(outerRadiusIndex, upperAziIndexEleFlipped, nEle2);
+            niRlAE4 = HRIRdata->row(innerRadiusIndex, lowerAziIndexEleFlipped, nEle2);
+            noRlAE4 = HRIRdata->row(outerRadiusIndex, lowerAziIndexEleFlipped, nEle2);
             nuAE4BaseCh = (uAziBaseCh + 1) % 2;
             nlAE4BaseCh = (lAziBaseCh + 1) % 2;
         } else if (nEle2 == numElevationSteps) {
-            niRuAE4 = niRlAE4 = HRIRdataPoles[innerRadiusIndex][1];
-            noRuAE4 = noRlAE4 = HRIRdataPoles[outerRadiusIndex][1];
+            niRuAE4 = niRlAE4 = HRIRdata->pole(innerRadiusIndex, 1);
+            noRuAE4 = noRlAE4 = HRIRdata->pole(outerRadiusIndex, 1);
             nuAE4BaseCh = nlAE4BaseCh = 0;
         } else {
-            niRuAE4 = HRIRdata[innerRadiusIndex][upperAzimuthIndex][nEle2-1];
-            noRuAE4 = HRIRdata[outerRadiusIndex][upperAzimuthIndex][nEle2-1];
-            niRlAE4 = HRIRdata[innerRadiusIndex][lowerAzimuthIndex][nEle2-1];
-            noRlAE4 = HRIRdata[outerRadiusIndex][lowerAzimuthIndex][nEle2-1];
+            niRuAE4 = HRIRdata->row(innerRadiusIndex, upperAzimuthIndex, nEle2);
+            noRuAE4 = HRIRdata->row(outerRadiusIndex, upperAzimuthIndex, nEle2);
+            niRlAE4 = HRIRdata->row(innerRadiusIndex, lowerAzimuthIndex, nEle2);
+            noRlAE4 = HRIRdata->row(outerRadiusIndex, lowerAzimuthIndex, nEle2);
             nuAE4BaseCh = uAziBaseCh;
             nlAE4BaseCh = lAziBaseCh;
         }
     } else {
-        mu1n = mu1 + 1;
         if (nEleFlip) {
-            niRuAE1 = HRIRdata[innerRadiusIndex][upperAziIndexEleFlipped][nEle2-1];
-            noRuAE1 = HRIRdata[outerRadiusIndex][upperAziIndexEleFlipped][nEle2-1];
-            niRlAE1 = HRIRdata[innerRadiusIndex][lowerAziIndexEleFlipped][nEle2-1];
-            noRlAE1 = HRIRdata[outerRadiusIndex][lowerAziIndexEleFlipped][nEle2-1];
+            niRuAE1 = HRIRdata->row(innerRadiusIndex, upperAziIndexEleFlipped, nEle2);
+            noRuAE1 = HRIRdata->row(outerRadiusIndex, upperAziIndexEleFlipped, nEle2);
+            niRlAE1 = HRIRdata->row(innerRadiusIndex, lowerAziIndexEleFlipped, nEle2);
+            noRlAE1 = HRIRdata->row(outerRadiusIndex, lowerAziIndexEleFlipped, nEle2);
             nuAE1BaseCh = (uAziBaseCh + 1) % 2;
             nlAE1BaseCh = (lAziBaseCh + 1) % 2;
         } else if (nEle2 == 0) {
-            niRuAE1 = niRlAE1 = HRIRdataPoles[innerRadiusIndex][0];
-            noRuAE1 = noRlAE1 = HRIRdataPoles[outerRadiusIndex][0];
+            niRuAE1 = niRlAE1 = HRIRdata->pole(innerRadiusIndex, 0);
+            noRuAE1 = noRlAE1 = HRIRdata->pole(outerRadiusIndex, 0);
             nuAE1BaseCh = nlAE1BaseCh = 0;
         } else {
-            niRuAE1 = HRIRdata[innerRadiusIndex][upperAzimuthIndex][nEle2-1];
-            noRuAE1 = HRIRdata[outerRadiusIndex][upperAzimuthIndex][nEle2-1];
-            niRlAE1 = HRIRdata[innerRadiusIndex][lowerAzimuthIndex][nEle2-1];
-            noRlAE1 = HRIRdata[outerRadiusIndex][lowerAzimuthIndex][nEle2-1];
+            niRuAE1 = HRIRdata->row(innerRadiusIndex, upperAzimuthIndex, nEle2);
+            noRuAE1 = HRIRdata->row(outerRadiusIndex, upperAzimuthIndex, nEle2);
+            niRlAE1 = HRIRdata->row(innerRadiusIndex, lowerAzimuthIndex, nEle2);
+            noRlAE1 = HRIRdata->row(outerRadiusIndex, lowerAzimuthIndex, nEle2);
             nuAE1BaseCh = uAziBaseCh;
             nlAE1BaseCh = lAziBaseCh;
         }
         if (lElem1Flip) {
-            niRuAE2 = HRIRdata[innerRadiusIndex][upperAziIndexEleFlipped][lElem1-1];
-            noRuAE2 = HRIRdata[outerRadiusIndex][upperAziIndexEleFlipped][lElem1-1];
-            niRlAE2 = HRIRdata[innerRadiusIndex][lowerAziIndexEleFlipped][lElem1-1];
-            noRlAE2 = HRIRdata[outerRadiusIndex][lowerAziIndexEleFlipped][lElem1-1];
+            niRuAE2 = HRIRdata->row(innerRadiusIndex, upperAziIndexEleFlipped, lElem1);
+            noRuAE2 = HRIRdata->row(outerRadiusIndex, upperAziIndexEleFlipped, lElem1);
+            niRlAE2 = HRIRdata->row(innerRadiusIndex, lowerAziIndexEleFlipped, lElem1);
+            noRlAE2 = HRIRdata->row(outerRadiusIndex, lowerAziIndexEleFlipped, lElem1);
             nuAE2BaseCh = (uAziBaseCh + 1) % 2;
             nlAE2BaseCh = (lAziBaseCh + 1) % 2;
         } else if (lElem1 == 0) {
-            niRuAE2 = niRlAE2 = HRIRdataPoles[innerRadiusIndex][0];
-            noRuAE2 = noRlAE2 = HRIRdataPoles[outerRadiusIndex][0];
+            niRuAE2 = niRlAE2 = HRIRdata->pole(innerRadiusIndex, 0);
+            noRuAE2 = noRlAE2 = HRIRdata->pole(outerRadiusIndex, 0);
             nuAE2BaseCh = nlAE2BaseCh = 0;
         } else {
-            niRuAE2 = HRIRdata[innerRadiusIndex][upperAzimuthIndex][lElem1-1];
-            noRuAE2 = HRIRdata[outerRadiusIndex][upperAzimuthIndex][lElem1-1];
-            niRlAE2 = HRIRdata[innerRadiusIndex][lowerAzimuthIndex][lElem1-1];
-            noRlAE2 = HRIRdata[outerRadiusIndex][lowerAzimuthIndex][lElem1-1];
+            niRuAE2 = HRIRdata->row(innerRadiusIndex, upperAzimuthIndex, lElem1);
+            noRuAE2 = HRIRdata->row(outerRadiusIndex, upperAzimuthIndex, lElem1);
+            niRlAE2 = HRIRdata->row(innerRadiusIndex, lowerAzimuthIndex, lElem1);
+            noRlAE2 = HRIRdata->row(outerRadiusIndex, lowerAzimuthIndex, lElem1);
             nuAE2BaseCh = uAziBaseCh;
             nlAE2BaseCh = lAziBaseCh;
         }
         if (lowerElevationIndex == 0) {
-            niRuAE3 = niRlAE3 = HRIRdataPoles[innerRadiusIndex][0];
-            noRuAE3 = noRlAE3 = HRIRdataPoles[outerRadiusIndex][0];
+            niRuAE3 = niRlAE3 = HRIRdata->pole(innerRadiusIndex, 0);
+            noRuAE3 = noRlAE3 = HRIRdata->pole(outerRadiusIndex, 0);
             nuAE3BaseCh = nlAE3BaseCh = 0;
         } else {
-            niRuAE3 = HRIRdata[innerRadiusIndex][upperAzimuthIndex][lowerElevationIndex-1];
-            noRuAE3 = HRIRdata[outerRadiusIndex][upperAzimuthIndex][lowerElevationIndex-1];
-            niRlAE3 = HRIRdata[innerRadiusIndex][lowerAzimuthIndex][lowerElevationIndex-1];
-            noRlAE3 = HRIRdata[outerRadiusIndex][lowerAzimuthIndex][lowerElevationIndex-1];
+            niRuAE3 = HRIRdata->row(innerRadiusIndex, upperAzimuthIndex, lowerElevationIndex);
+            noRuAE3 = HRIRdata->row(outerRadiusIndex, upperAzimuthIndex, lowerElevationIndex);
+            niRlAE3 = HRIRdata->row(innerRadiusIndex, lowerAzimuthIndex, lowerElevationIndex);
+            noRlAE3 = HRIRdata->row(outerRadiusIndex, lowerAzimuthIndex, lowerElevationIndex);
             nuAE3BaseCh = uAziBaseCh;
             nlAE3BaseCh = lAziBaseCh;
         }
         if (upperElevationIndex == numElevationSteps) {
-            niRuAE4 = niRlAE4 = HRIRdataPoles[innerRadiusIndex][1];
-            noRuAE4 = noRlAE4 = HRIRdataPoles[outerRadiusIndex][1];
+            niRuAE4 = niRlAE4 = HRIRdata->pole(innerRadiusIndex, 1);
+            noRuAE4 = noRlAE4 = HRIRdata->pole(outerRadiusIndex, 1);
             nuAE4BaseCh = nlAE4BaseCh = 0;
         } else {
-            niRuAE4 = HRIRdata[innerRadiusIndex][upperAzimuthIndex][upperElevationIndex-1];
-            noRuAE4 = HRIRdata[outerRadiusIndex][upperAzimuthIndex][upperElevationIndex-1];
-            niRlAE4 = HRIRdata[innerRadiusIndex][lowerAzimuthIndex][upperElevationIndex-1];
-            noRlAE4 = HRIRdata[outerRadiusIndex][lowerAzimuthIndex][upperElevationIndex-1];
+            niRuAE4 = HRIRdata->row(innerRadiusIndex, upperAzimuthIndex, upperElevationIndex);
+            noRuAE4 = HRIRdata->row(outerRadiusIndex, upperAzimuthIndex, upperElevationIndex);
+            niRlAE4 = HRIRdata->row(innerRadiusIndex, lowerAzimuthIndex, upperElevationIndex);
+            noRlAE4 = HRIRdata->row(outerRadiusIndex, lowerAzimuthIndex, upperElevationIndex);
             nuAE4BaseCh = uAziBaseCh;
             nlAE4BaseCh = lAziBaseCh;
         }
     }
     if (lElem1Flip) {
-        iRuAE1 = HRIRdata[innerRadiusIndex][upperAziIndexEleFlipped][lElem1-1];
-        iRlAE1 = HRIRdata[innerRadiusIndex][lowerAziIndexEleFlipped][lElem1-1];
-        oRuAE1 = HRIRdata[outerRadiusIndex][upperAziIndexEleFlipped][lElem1-1];
-        oRlAE1 = HRIRdata[outerRadiusIndex][lowerAziIndexEleFlipped][lElem1-1];
+        iRuAE1 = HRIRdata->row(innerRadiusIndex, upperAziIndexEleFlipped, lElem1);
+        iRlAE1 = HRIRdata->row(innerRadiusIndex, lowerAziIndexEleFlipped, lElem1);
+        oRuAE1 = HRIRdata->row(outerRadiusIndex, upperAziIndexEleFlipped, lElem1);
+        oRlAE1 = HRIRdata->row(outerRadiusIndex, lowerAziIndexEleFlipped, lElem1);
         uAE1BaseCh = (uAziBaseCh + 1) % 2;
         lAE1BaseCh = (lAziBaseCh + 1) % 2;
     } else if (lElem1 == 0) {
-        iRuAE1 = iRlAE1 = HRIRdataPoles[innerRadiusIndex][0];
-        oRuAE1 = oRlAE1 = HRIRdataPoles[outerRadiusIndex][0];
+        iRuAE1 = iRlAE1 = HRIRdata->pole(innerRadiusIndex, 0);
+        oRuAE1 = oRlAE1 = HRIRdata->pole(outerRadiusIndex, 0);
         uAE1BaseCh = lAE1BaseCh = 0;
     } else {
-        iRuAE1 = HRIRdata[innerRadiusIndex][upperAzimuthIndex][lElem1-1];
-        iRlAE1 = HRIRdata[innerRadiusIndex][lowerAzimuthIndex][lElem1-1];
-        oRuAE1 = HRIRdata[outerRadiusIndex][upperAzimuthIndex][lElem1-1];
-        oRlAE1 = HRIRdata[outerRadiusIndex][lowerAzimuthIndex][lElem1-1];
+        iRuAE1 = HRIRdata->row(innerRadiusIndex, upperAzimuthIndex, lElem1);
+        iRlAE1 = HRIRdata->row(innerRadiusIndex, lowerAzimuthIndex, lElem1);
+        oRuAE1 = HRIRdata->row(outerRadiusIndex, upperAzimuthIndex, lElem1);
+        oRlAE1 = HRIRdata->row(outerRadiusIndex, lowerAzimuthIndex, lElem1);
         uAE1BaseCh = uAziBaseCh;
         lAE1BaseCh = lAziBaseCh;
     }
     if (lowerElevationIndex == 0) {
-        iRuAE2 = iRlAE2 = HRIRdataPoles[innerRadiusIndex][0];
-        oRuAE2 = oRlAE2 = HRIRdataPoles[outerRadiusIndex][0];
+        iRuAE2 = iRlAE2 = HRIRdata->pole(innerRadiusIndex, 0);
+        oRuAE2 = oRlAE2 = HRIRdata->pole(outerRadiusIndex, 0);
     } else {
-        iRuAE2 = HRIRdata[innerRadiusIndex][upperAzimuthIndex][lowerElevationIndex-1];
-        iRlAE2 = HRIRdata[innerRadiusIndex][lowerAzimuthIndex][lowerElevationIndex-1];
-        oRuAE2 = HRIRdata[outerRadiusIndex][upperAzimuthIndex][lowerElevationIndex-1];
-        oRlAE2 = HRIRdata[outerRadiusIndex][lowerAzimuthIndex][lowerElevationIndex-1];
+        iRuAE2 = HRIRdata->row(innerRadiusIndex, upperAzimuthIndex, lowerElevationIndex);
+        iRlAE2 = HRIRdata->row(innerRadiusIndex, lowerAzimuthIndex, lowerElevationIndex);
+        oRuAE2 = HRIRdata->row(outerRadiusIndex, upperAzimuthIndex, lowerElevationIndex);
+        oRlAE2 = HRIRdata->row(outerRadiusIndex, lowerAzimuthIndex, lowerElevationIndex);
     }
     if (upperElevationIndex == numElevationSteps) {
-        iRuAE3 = iRlAE3 = HRIRdataPoles[innerRadiusIndex][1];
-        oRuAE3 = oRlAE3 = HRIRdataPoles[outerRadiusIndex][1];
+        iRuAE3 = iRlAE3 = HRIRdata->pole(innerRadiusIndex, 1);
+        oRuAE3 = oRlAE3 = HRIRdata->pole(outerRadiusIndex, 1);
         //uAE3BaseCh = lAE3BaseCh = 0;
     } else {
-        iRuAE3 = HRIRdata[innerRadiusIndex][upperAzimuthIndex][upperElevationIndex-1];
-        iRlAE3 = HRIRdata[innerRadiusIndex][lowerAzimuthIndex][upperElevationIndex-1];
-        oRuAE3 = HRIRdata[outerRadiusIndex][upperAzimuthIndex][upperElevationIndex-1];
-        oRlAE3 = HRIRdata[outerRadiusIndex][lowerAzimuthIndex][upperElevationIndex-1];
+        iRuAE3 = HRIRdata->row(innerRadiusIndex, upperAzimuthIndex, upperElevationIndex);
+        iRlAE3 = HRIRdata->row(innerRadiusIndex, lowerAzimuthIndex, upperElevationIndex);
+        oRuAE3 = HRIRdata->row(outerRadiusIndex, upperAzimuthIndex, upperElevationIndex);
+        oRlAE3 = HRIRdata->row(outerRadiusIndex, lowerAzimuthIndex, upperElevationIndex);
         //uAE3BaseCh = uAziBaseCh;
         //lAE3BaseCh = lAziBaseCh;
     }
     if (uElep1Flip) {
-        iRuAE4 = HRIRdata[innerRadiusIndex][upperAziIndexEleFlipped][uElep1-1];
-        iRlAE4 = HRIRdata[innerRadiusIndex][lowerAziIndexEleFlipped][uElep1-1];
-        oRuAE4 = HRIRdata[outerRadiusIndex][upperAziIndexEleFlipped][uElep1-1];
-        oRlAE4 = HRIRdata[outerRadiusIndex][lowerAziIndexEleFlipped][uElep1-1];
+        iRuAE4 = HRIRdata->row(innerRadiusIndex, upperAziIndexEleFlipped, uElep1);
+        iRlAE4 = HRIRdata->row(innerRadiusIndex, lowerAziIndexEleFlipped, uElep1);
+        oRuAE4 = HRIRdata->row(outerRadiusIndex, upperAziIndexEleFlipped, uElep1);
+        oRlAE4 = HRIRdata->row(outerRadiusIndex, lowerAziIndexEleFlipped, uElep1);
         uAE4BaseCh = (uAziBaseCh + 1) % 2;
         lAE4BaseCh = (lAziBaseCh + 1) % 2;
     } else if (uElep1 == numElevationSteps) {
-        iRuAE4 = iRlAE4 = HRIRdataPoles[innerRadiusIndex][1];
-        oRuAE4 = oRlAE4 = HRIRdataPoles[outerRadiusIndex][1];
+        iRuAE4 = iRlAE4 = HRIRdata->pole(innerRadiusIndex, 1);
+        oRuAE4 = oRlAE4 = HRIRdata->pole(outerRadiusIndex, 1);
         uAE4BaseCh = lAE4BaseCh = 0;
     } else {
-        iRuAE4 = HRIRdata[innerRadiusIndex][upperAzimuthIndex][uElep1-1];
-        iRlAE4 = HRIRdata[innerRadiusIndex][lowerAzimuthIndex][uElep1-1];
-        oRuAE4 = HRIRdata[outerRadiusIndex][upperAzimuthIndex][uElep1-1];
-        oRlAE4 = HRIRdata[outerRadiusIndex][lowerAzimuthIndex][uElep1-1];
+        iRuAE4 = HRIRdata->row(innerRadiusIndex, upperAzimuthIndex, uElep1);
+        iRlAE4 = HRIRdata->row(innerRadiusIndex, lowerAzimuthIndex, uElep1);
+        oRuAE4 = HRIRdata->row(outerRadiusIndex, upperAzimuthIndex, uElep1);
+        oRlAE4 = HRIRdata->row(outerRadiusIndex, lowerAzimuthIndex, uElep1);
         uAE4BaseCh = uAziBaseCh;
         lAE4BaseCh = lAziBaseCh;
     }
     
-    float mu2n;
     if (nAziUp) {
-        mu2n = mu2 - 1;
         if (lowerElevationIndex == 0) {
-            niRA1lE = niRA2lE = niRA3lE = niRA4lE = HRIRdataPoles[innerRadiusIndex][0];
-            noRA1lE = noRA2lE = noRA3lE = noRA4lE = HRIRdataPoles[outerRadiusIndex][0];
+            niRA1lE = niRA2lE = niRA3lE = niRA4lE = HRIRdata->pole(innerRadiusIndex, 0);
+            noRA1lE = noRA2lE = noRA3lE = noRA4lE = HRIRdata->pole(outerRadiusIndex, 0);
             nA1lEBaseCh = nA2lEBaseCh = nA3lEBaseCh = nA4lEBaseCh = 0;
         } else {
-            niRA1lE = HRIRdata[innerRadiusIndex][lowerAzimuthIndex][lowerElevationIndex-1];
-            niRA2lE = HRIRdata[innerRadiusIndex][upperAzimuthIndex][lowerElevationIndex-1];
-            niRA3lE = HRIRdata[innerRadiusIndex][uAzip1]           [lowerElevationIndex-1];
-            niRA4lE = HRIRdata[innerRadiusIndex][nAzi2]            [lowerElevationIndex-1];
-            noRA1lE = HRIRdata[outerRadiusIndex][lowerAzimuthIndex][lowerElevationIndex-1];
-            noRA2lE = HRIRdata[outerRadiusIndex][upperAzimuthIndex][lowerElevationIndex-1];
-            noRA3lE = HRIRdata[outerRadiusIndex][uAzip1]           [lowerElevationIndex-1];
-            noRA4lE = HRIRdata[outerRadiusIndex][nAzi2]            [lowerElevationIndex-1];
+            niRA1lE = HRIRdata->row(innerRadiusIndex, lowerAzimuthIndex, lowerElevationIndex);
+            niRA2lE = HRIRdata->row(innerRadiusIndex, upperAzimuthIndex, lowerElevationIndex);
+            niRA3lE = HRIRdata->row(innerRadiusIndex, uAzip1,            lowerElevationIndex);
+            niRA4lE = HRIRdata->row(innerRadiusIndex, nAzi2,             lowerElevationIndex);
+            noRA1lE = HRIRdata->row(outerRadiusIndex, lowerAzimuthIndex, lowerElevationIndex);
+            noRA2lE = HRIRdata->row(outerRadiusIndex, upperAzimuthIndex, lowerElevationIndex);
+            noRA3lE = HRIRdata->row(outerRadiusIndex, uAzip1,            lowerElevationIndex);
+            noRA4lE = HRIRdata->row(outerRadiusIndex, nAzi2,             lowerElevationIndex);
             nA1lEBaseCh = lAziBaseCh;
             nA2lEBaseCh = uAziBaseCh;
             nA3lEBaseCh = uAzip1BaseCh;
             nA4lEBaseCh = nAziBaseCh;
         }
         if (upperElevationIndex == numElevationSteps) {
-            niRA1uE = niRA2uE = niRA3uE = niRA4uE = HRIRdataPoles[innerRadiusIndex][1];
-            noRA1uE = noRA2uE = noRA3uE = noRA4uE = HRIRdataPoles[outerRadiusIndex][1];
+            niRA1uE = niRA2uE = niRA3uE = niRA4uE = HRIRdata->pole(innerRadiusIndex, 1);
+            noRA1uE = noRA2uE = noRA3uE = noRA4uE = HRIRdata->pole(outerRadiusIndex, 1);
             nA1uEBaseCh = nA2uEBaseCh = nA3uEBaseCh = nA4uEBaseCh = 0;
         } else {
-            niRA1uE = HRIRdata[innerRadiusIndex][lowerAzimuthIndex][upperElevationIndex-1];
-            niRA2uE = HRIRdata[innerRadiusIndex][upperAzimuthIndex][upperElevationIndex-1];
-            niRA3uE = HRIRdata[innerRadiusIndex][uAzip1]           [upperElevationIndex-1];
-            niRA4uE = HRIRdata[innerRadiusIndex][nAzi2]            [upperElevationIndex-1];
-            noRA1uE = HRIRdata[outerRadiusIndex][lowerAzimuthIndex][upperElevationIndex-1];
-            noRA2uE = HRIRdata[outerRadiusIndex][upperAzimuthIndex][upperElevationIndex-1];
-            noRA3uE = HRIRdata[outerRadiusIndex][uAzip1]           [upperElevationIndex-1];
-            noRA4uE = HRIRdata[outerRadiusIndex][nAzi2]            [upperElevationIndex-1];
+            niRA1uE = HRIRdata->row(innerRadiusIndex, lowerAzimuthIndex, upperElevationIndex);
+            niRA2uE = HRIRdata->row(innerRadiusIndex, upperAzimuthIndex, upperElevationIndex);
+            niRA3uE = HRIRdata->row(innerRadiusIndex, uAzip1,            upperElevationIndex);
+            niRA4uE = HRIRdata->row(innerRadiusIndex, nAzi2,             upperElevationIndex);
+            noRA1uE = HRIRdata->row(outerRadiusIndex, lowerAzimuthIndex, upperElevationIndex);
+            noRA2uE = HRIRdata->row(outerRadiusIndex, upperAzimuthIndex, upperElevationIndex);
+            noRA3uE = HRIRdata->row(outerRadiusIndex, uAzip1,            upperElevationIndex);
+            noRA4uE = HRIRdata->row(outerRadiusIndex, nAzi2,             upperElevationIndex);
             nA1uEBaseCh = lAziBaseCh;
             nA2uEBaseCh = uAziBaseCh;
             nA3uEBaseCh = uAzip1BaseCh;
             nA4uEBaseCh = nAziBaseCh;
         }
     } else {
-        mu2n = mu2 + 1;
         if (lowerElevationIndex == 0) { // NOTE; this is exact same as in nAziUp above
-            niRA1lE = niRA2lE = niRA3lE = niRA4lE = HRIRdataPoles[innerRadiusIndex][0];
-            noRA1lE = noRA2lE = noRA3lE = noRA4lE = HRIRdataPoles[outerRadiusIndex][0];
+            niRA1lE = niRA2lE = niRA3lE = niRA4lE = HRIRdata->pole(innerRadiusIndex, 0);
+            noRA1lE = noRA2lE = noRA3lE = noRA4lE = HRIRdata->pole(outerRadiusIndex, 0);
             nA1lEBaseCh = nA2lEBaseCh = nA3lEBaseCh = nA4lEBaseCh = 0;
         } else {
-            niRA1lE = HRIRdata[innerRadiusIndex][nAzi2]            [lowerElevationIndex-1];
-            niRA2lE = HRIRdata[innerRadiusIndex][lAzim1]           [lowerElevationIndex-1];
-            niRA3lE = HRIRdata[innerRadiusIndex][lowerAzimuthIndex][lowerElevationIndex-1];
-            niRA4lE = HRIRdata[innerRadiusIndex][upperAzimuthIndex][lowerElevationIndex-1];
-            noRA1lE = HRIRdata[outerRadiusIndex][nAzi2]            [lowerElevationIndex-1];
-            noRA2lE = HRIRdata[outerRadiusIndex][lAzim1]           [lowerElevationIndex-1];
-            noRA3lE = HRIRdata[outerRadiusIndex][lowerAzimuthIndex][lowerElevationIndex-1];
-            noRA4lE = HRIRdata[outerRadiusIndex][upperAzimuthIndex][lowerElevationIndex-1];
+            niRA1lE = HRIRdata->row(innerRadiusIndex, nAzi2,             lowerElevationIndex);
+            niRA2lE = HRIRdata->row(innerRadiusIndex, lAzim1,            lowerElevationIndex);
+            niRA3lE = HRIRdata->row(innerRadiusIndex, lowerAzimuthIndex, lowerElevationIndex);
+            niRA4lE = HRIRdata->row(innerRadiusIndex, upperAzimuthIndex, lowerElevationIndex);
+            noRA1lE = HRIRdata->row(outerRadiusIndex, nAzi2,             lowerElevationIndex);
+            noRA2lE = HRIRdata->row(outerRadiusIndex, lAzim1,            lowerElevationIndex);
+            noRA3lE = HRIRdata->row(outerRadiusIndex, lowerAzimuthIndex, lowerElevationIndex);
+            noRA4lE = HRIRdata->row(outerRadiusIndex, upperAzimuthIndex, lowerElevationIndex);
             nA1lEBaseCh = nAziBaseCh;
             nA2lEBaseCh = lAzim1BaseCh;
             nA3lEBaseCh = lAziBaseCh;
             nA4lEBaseCh = uAziBaseCh;
         }
         if (upperElevationIndex == numElevationSteps) { // NOTE; this is exact same as in nAziUp above
-            niRA1uE = niRA2uE = niRA3uE = niRA4uE = HRIRdataPoles[innerRadiusIndex][1];
-            noRA1uE = noRA2uE = noRA3uE = noRA4uE = HRIRdataPoles[outerRadiusIndex][1];
+            niRA1uE = niRA2uE = niRA3uE = niRA4uE = HRIRdata->pole(innerRadiusIndex, 1);
+            noRA1uE = noRA2uE = noRA3uE = noRA4uE = HRIRdata->pole(outerRadiusIndex, 1);
             nA1uEBaseCh = nA2uEBaseCh = nA3uEBaseCh = nA4uEBaseCh = 0;
         } else {
-            niRA1uE = HRIRdata[innerRadiusIndex][nAzi2]            [upperElevationIndex-1];
-            niRA2uE = HRIRdata[innerRadiusIndex][lAzim1]           [upperElevationIndex-1];
-            niRA3uE = HRIRdata[innerRadiusIndex][lowerAzimuthIndex][upperElevationIndex-1];
-            niRA4uE = HRIRdata[innerRadiusIndex][upperAzimuthIndex][upperElevationIndex-1];
-            noRA1uE = HRIRdata[outerRadiusIndex][nAzi2]            [upperElevationIndex-1];
-            noRA2uE = HRIRdata[outerRadiusIndex][lAzim1]           [upperElevationIndex-1];
-            noRA3uE = HRIRdata[outerRadiusIndex][lowerAzimuthIndex][upperElevationIndex-1];
-            noRA4uE = HRIRdata[outerRadiusIndex][upperAzimuthIndex][upperElevationIndex-1];
+            niRA1uE = HRIRdata->row(innerRadiusIndex, nAzi2,             upperElevationIndex);
+            niRA2uE = HRIRdata->row(innerRadiusIndex, lAzim1,            upperElevationIndex);
+            niRA3uE = HRIRdata->row(innerRadiusIndex, lowerAzimuthIndex, upperElevationIndex);
+            niRA4uE = HRIRdata->row(innerRadiusIndex, upperAzimuthIndex, upperElevationIndex);
+            noRA1uE = HRIRdata->row(outerRadiusIndex, nAzi2,             upperElevationIndex);
+            noRA2uE = HRIRdata->row(outerRadiusIndex, lAzim1,            upperElevationIndex);
+            noRA3uE = HRIRdata->row(outerRadiusIndex, lowerAzimuthIndex, upperElevationIndex);
+            noRA4uE = HRIRdata->row(outerRadiusIndex, upperAzimuthIndex, upperElevationIndex);
             nA1uEBaseCh = nAziBaseCh;
             nA2uEBaseCh = lAzim1BaseCh;
             nA3uEBaseCh = lAziBaseCh;
@@ -1593,157 +2055,71 @@ void PlayableSoundSource::interpolateHRIR(const float* rae, float* hrir) const n
         }
     }
     if (lowerElevationIndex == 0) {
-        iRA1lE = iRA2lE = iRA3lE = iRA4lE = HRIRdataPoles[innerRadiusIndex][0];
-        oRA1lE = oRA2lE = oRA3lE = oRA4lE = HRIRdataPoles[outerRadiusIndex][0];
+        iRA1lE = iRA2lE = iRA3lE = iRA4lE = HRIRdata->pole(innerRadiusIndex, 0);
+        oRA1lE = oRA2lE = oRA3lE = oRA4lE = HRIRdata->pole(outerRadiusIndex, 0);
     } else {
-        iRA1lE = HRIRdata[innerRadiusIndex][lAzim1]           [lowerElevationIndex-1];
-        iRA2lE = HRIRdata[innerRadiusIndex][lowerAzimuthIndex][lowerElevationIndex-1];
-        iRA3lE = HRIRdata[innerRadiusIndex][upperAzimuthIndex][lowerElevationIndex-1];
-        iRA4lE = HRIRdata[innerRadiusIndex][uAzip1]           [lowerElevationIndex-1];
-        oRA1lE = HRIRdata[outerRadiusIndex][lAzim1]           [lowerElevationIndex-1];
-        oRA2lE = HRIRdata[outerRadiusIndex][lowerAzimuthIndex][lowerElevationIndex-1];
-        oRA3lE = HRIRdata[outerRadiusIndex][upperAzimuthIndex][lowerElevationIndex-1];
-        oRA4lE = HRIRdata[outerRadiusIndex][uAzip1]           [lowerElevationIndex-1];
+        iRA1lE = HRIRdata->row(innerRadiusIndex, lAzim1,            lowerElevationIndex);
+        iRA2lE = HRIRdata->row(innerRadiusIndex, lowerAzimuthIndex, lowerElevationIndex);
+        iRA3lE = HRIRdata->row(innerRadiusIndex, upperAzimuthIndex, lowerElevationIndex);
+        iRA4lE = HRIRdata->row(innerRadiusIndex, uAzip1,            lowerElevationIndex);
+        oRA1lE = HRIRdata->row(outerRadiusIndex, lAzim1,            lowerElevationIndex);
+        oRA2lE = HRIRdata->row(outerRadiusIndex, lowerAzimuthIndex, lowerElevationIndex);
+        oRA3lE = HRIRdata->row(outerRadiusIndex, upperAzimuthIndex, lowerElevationIndex);
+        oRA4lE = HRIRdata->row(outerRadiusIndex, uAzip1,            lowerElevationIndex);
     }
     if (upperElevationIndex == numElevationSteps) {
-        iRA1uE = iRA2uE = iRA3uE = iRA4uE = HRIRdataPoles[innerRadiusIndex][1];
-        oRA1uE = oRA2uE = oRA3uE = oRA4uE = HRIRdataPoles[outerRadiusIndex][1];
+        iRA1uE = iRA2uE = iRA3uE = iRA4uE = HRIRdata->pole(innerRadiusIndex, 1);
+        oRA1uE = oRA2uE = oRA3uE = oRA4uE = HRIRdata->pole(outerRadiusIndex, 1);
     } else {
-        iRA1uE = HRIRdata[innerRadiusIndex][lAzim1]           [upperElevationIndex-1];
-        iRA2uE = HRIRdata[innerRadiusIndex][lowerAzimuthIndex][upperElevationIndex-1];
-        iRA3uE = HRIRdata[innerRadiusIndex][upperAzimuthIndex][upperElevationIndex-1];
-        iRA4uE = HRIRdata[innerRadiusIndex][uAzip1]           [upperElevationIndex-1];
-        oRA1uE = HRIRdata[outerRadiusIndex][lAzim1]           [upperElevationIndex-1];
-        oRA2uE = HRIRdata[outerRadiusIndex][lowerAzimuthIndex][upperElevationIndex-1];
-        oRA3uE = HRIRdata[outerRadiusIndex][upperAzimuthIndex][upperElevationIndex-1];
-        oRA4uE = HRIRdata[outerRadiusIndex][uAzip1]           [upperElevationIndex-1];
+        iRA1uE = HRIRdata->row(innerRadiusIndex, lAzim1,            upperElevationIndex);
+        iRA2uE = HRIRdata->row(innerRadiusIndex, lowerAzimuthIndex, upperElevationIndex);
+        iRA3uE = HRIRdata->row(innerRadiusIndex, upperAzimuthIndex, upperElevationIndex);
+        iRA4uE = HRIRdata->row(innerRadiusIndex, uAzip1,            upperElevationIndex);
+        oRA1uE = HRIRdata->row(outerRadiusIndex, lAzim1,            upperElevationIndex);
+        oRA2uE = HRIRdata->row(outerRadiusIndex, lowerAzimuthIndex, upperElevationIndex);
+        oRA3uE = HRIRdata->row(outerRadiusIndex, upperAzimuthIndex, upperElevationIndex);
+        oRA4uE = HRIRdata->row(outerRadiusIndex, uAzip1,            upperElevationIndex);
 //        A1uEBaseCh = lAzim1BaseCh;
 //        A2uEBaseCh = lAziBaseCh;
 //        A3uEBaseCh = uAziBaseCh;
 //        A4uEBaseCh = uAzip1BaseCh;
     }
     
-    // mu1's are for azi interp
-    const float mu1_1 = mu1 - 1;
-    const float mu1_2 = mu1 - 2;
-    const float mu1_3 = mu1 - 3;
-    const float mu1_4 = mu1 - 4;
-    const float mu1n_1 = mu1n - 1;
-    const float mu1n_2 = mu1n - 2;
-    const float mu1n_3 = mu1n - 3;
-    const float mu1n_4 = mu1n - 4;
-    
-    // mu2's are for ele interp
-    const float mu2_1 = mu2 - 1;
-    const float mu2_2 = mu2 - 2;
-    const float mu2_3 = mu2 - 3;
-    const float mu2_4 = mu2 - 4;
-    const float mu2n_1 = mu2n - 1;
-    const float mu2n_2 = mu2n - 2;
-    const float mu2n_3 = mu2n - 3;
-    const float mu2n_4 = mu2n - 4;
-    
-    const float oneminus_nmu1 = 1.0 - nmu1;
-    const float oneminus_nmu2 = 1.0 - nmu2;
-    const float oneminus_mu3 = 0.5*intensity_factor - mu3;//1.0 - mu3; // scaled by 1/2*intensity_factor here instead of for each sample below
-    const float oneminus_mu1_01 = 1.0 - mu1_01;
-    const float oneminus_mu2_01 = 1.0 - mu2_01;
-    
-    const float a1 = mu1_2 * mu1_3 * mu1_4 * -0.1666666666666666667;
-    const float a2 = mu1_1 * mu1_3 * mu1_4 * 0.5;
-    const float a3 = mu1_1 * mu1_2 * mu1_4 * -0.5;
-    const float a4 = mu1_1 * mu1_2 * mu1_3 * 0.1666666666666666667;
-    const float na1 = mu1n_2 * mu1n_3 * mu1n_4 * -0.1666666666666666667;
-    const float na2 = mu1n_1 * mu1n_3 * mu1n_4 * 0.5;
-    const float na3 = mu1n_1 * mu1n_2 * mu1n_4 * -0.5;
-    const float na4 = mu1n_1 * mu1n_2 * mu1n_3 * 0.1666666666666666667;
-    
-    const float e1 = mu2_2 * mu2_3 * mu2_4 * -0.1666666666666666667;
-    const float e2 = mu2_1 * mu2_3 * mu2_4 * 0.5;
-    const float e3 = mu2_1 * mu2_2 * mu2_4 * -0.5;
-    const float e4 = mu2_1 * mu2_2 * mu2_3 * 0.1666666666666666667;
-    const float ne1 = mu2n_2 * mu2n_3 * mu2n_4 * -0.1666666666666666667;
-    const float ne2 = mu2n_1 * mu2n_3 * mu2n_4 * 0.5;
-    const float ne3 = mu2n_1 * mu2n_2 * mu2n_4 * -0.5;
-    const float ne4 = mu2n_1 * mu2n_2 * mu2n_3 * 0.1666666666666666667;
-    
-    // intermediate interpolation values (in-region/nearby)(inner/outer)(azimuth/elevation)(plus/minus)
-    float inAp, inAm, inEp, inEm, outAp, outAm, outEp, outEm, netIn, netOut;
-    
-    bool again = true;
-    int hrirCh = 0;
-AGAIN:
-    for (int n = 0; n < numTimeSteps; ++n)
+    // the hrir is a weighted sum of the 64 neighboring hrirs above, whose weights are the products of the weights of each stage of the interpolation (see interpolateHRIR()).
+    // many neighbors are the same hrir, so the terms' weights get summed up per distinct hrir (row of the data and which of its channels is the left) first.
+    neighbors.numNeighbors = 0;
+    int numTerms = 0;
+    const auto add = [&neighbors, &numTerms] (const float* row, const int baseCh) noexcept
     {
-        inAp = nmu1*(na1*niRuAE1[nuAE1BaseCh][n] + na2*niRuAE2[nuAE2BaseCh][n] + na3*niRuAE3[nuAE3BaseCh][n] + na4*niRuAE4[nuAE4BaseCh][n])
-    + oneminus_nmu1*( a1* iRuAE1[ uAE1BaseCh][n] +  a2* iRuAE2[ uAziBaseCh][n] +  a3* iRuAE3[ uAziBaseCh][n] +  a4* iRuAE4[ uAE4BaseCh][n]);
-        
-        inAm = nmu1*(na1*niRlAE1[nlAE1BaseCh][n] + na2*niRlAE2[nlAE2BaseCh][n] + na3*niRlAE3[nlAE3BaseCh][n] + na4*niRlAE4[nlAE4BaseCh][n])
-    + oneminus_nmu1*( a1* iRlAE1[ lAE1BaseCh][n] +  a2* iRlAE2[ lAziBaseCh][n] +  a3* iRlAE3[ lAziBaseCh][n] +  a4* iRlAE4[ lAE4BaseCh][n]);
-        
-        outAp = nmu1*(na1*noRuAE1[nuAE1BaseCh][n] + na2*noRuAE2[nuAE2BaseCh][n] + na3*noRuAE3[nuAE3BaseCh][n] + na4*noRuAE4[nuAE4BaseCh][n])
-     + oneminus_nmu1*( a1* oRuAE1[ uAE1BaseCh][n] +  a2* oRuAE2[ uAziBaseCh][n] +  a3* oRuAE3[ uAziBaseCh][n] +  a4* oRuAE4[ uAE4BaseCh][n]);
-        
-        outAm = nmu1*(na1*noRlAE1[nlAE1BaseCh][n] + na2*noRlAE2[nlAE2BaseCh][n] + na3*noRlAE3[nlAE3BaseCh][n] + na4*noRlAE4[nlAE4BaseCh][n])
-     + oneminus_nmu1*( a1* oRlAE1[ lAE1BaseCh][n] +  a2* oRlAE2[ lAziBaseCh][n] +  a3* oRlAE3[ lAziBaseCh][n] +  a4* oRlAE4[ lAE4BaseCh][n]);
-        
-        
-        inEp = nmu2*(ne1*niRA1uE[ nA1uEBaseCh][n] + ne2*niRA2uE[nA2uEBaseCh][n] + ne3*niRA3uE[nA3uEBaseCh][n] + ne4*niRA4uE[ nA4uEBaseCh][n])
-    + oneminus_nmu2*( e1* iRA1uE[lAzim1BaseCh][n] +  e2* iRA2uE[ lAziBaseCh][n] +  e3* iRA3uE[ uAziBaseCh][n] +  e4* iRA4uE[uAzip1BaseCh][n]);
-        
-        inEm = nmu2*(ne1*niRA1lE[ nA1lEBaseCh][n] + ne2*niRA2lE[nA2lEBaseCh][n] + ne3*niRA3lE[nA3lEBaseCh][n] + ne4*niRA4lE[ nA4lEBaseCh][n])
-    + oneminus_nmu2*( e1* iRA1lE[lAzim1BaseCh][n] +  e2* iRA2lE[ lAziBaseCh][n] +  e3* iRA3lE[ uAziBaseCh][n] +  e4* iRA4lE[uAzip1BaseCh][n]);
-        
-        outEp = nmu2*(ne1*noRA1uE[ nA1uEBaseCh][n] + ne2*noRA2uE[nA2uEBaseCh][n] + ne3*noRA3uE[nA3uEBaseCh][n] + ne4*noRA4uE[ nA4uEBaseCh][n])
-     + oneminus_nmu2*( e1* oRA1uE[lAzim1BaseCh][n] +  e2* oRA2uE[ lAziBaseCh][n] +  e3* oRA3uE[ uAziBaseCh][n] +  e4* oRA4uE[uAzip1BaseCh][n]);
-        
-        outEm = nmu2*(ne1*noRA1lE[ nA1lEBaseCh][n] + ne2*noRA2lE[nA2lEBaseCh][n] + ne3*noRA3lE[nA3lEBaseCh][n] + ne4*noRA4lE[ nA4lEBaseCh][n])
-     + oneminus_nmu2*( e1* oRA1lE[lAzim1BaseCh][n] +  e2* oRA2lE[ lAziBaseCh][n] +  e3* oRA3lE[ uAziBaseCh][n] +  e4* oRA4lE[uAzip1BaseCh][n]);
-        
-        
-        netIn  = (oneminus_mu1_01*inEm  + mu1_01*inEp)
-               + (oneminus_mu2_01*inAm  + mu2_01*inAp);
-        netOut = (oneminus_mu1_01*outEm + mu1_01*outEp)
-               + (oneminus_mu2_01*outAm + mu2_01*outAp);
-        
-        hrir[hrirCh*numTimeSteps+n] = /*0.5*intensity_factor**/(mu3*netOut + oneminus_mu3*netIn);
-    }
-    if (again)
-    {
-        nuAE1BaseCh = (nuAE1BaseCh + 1) % 2;
-        nuAE2BaseCh = (nuAE2BaseCh + 1) % 2;
-        nuAE3BaseCh = (nuAE3BaseCh + 1) % 2;
-        nuAE4BaseCh = (nuAE4BaseCh + 1) % 2;
-        nlAE1BaseCh = (nlAE1BaseCh + 1) % 2;
-        nlAE2BaseCh = (nlAE2BaseCh + 1) % 2;
-        nlAE3BaseCh = (nlAE3BaseCh + 1) % 2;
-        nlAE4BaseCh = (nlAE4BaseCh + 1) % 2;
-         uAE1BaseCh = ( uAE1BaseCh + 1) % 2;
-         //uAE3BaseCh = ( uAE3BaseCh + 1) % 2;
-         uAE4BaseCh = ( uAE4BaseCh + 1) % 2;
-         lAE1BaseCh = ( lAE1BaseCh + 1) % 2;
-         //lAE3BaseCh = ( lAE3BaseCh + 1) % 2;
-         lAE4BaseCh = ( lAE4BaseCh + 1) % 2;
-        nA1uEBaseCh = (nA1uEBaseCh + 1) % 2;
-        nA2uEBaseCh = (nA2uEBaseCh + 1) % 2;
-        nA3uEBaseCh = (nA3uEBaseCh + 1) % 2;
-        nA4uEBaseCh = (nA4uEBaseCh + 1) % 2;
-        nA1lEBaseCh = (nA1lEBaseCh + 1) % 2;
-        nA2lEBaseCh = (nA2lEBaseCh + 1) % 2;
-        nA3lEBaseCh = (nA3lEBaseCh + 1) % 2;
-        nA4lEBaseCh = (nA4lEBaseCh + 1) % 2;
-//         A1uEBaseCh = ( A1uEBaseCh + 1) % 2;
-//         A2uEBaseCh = ( A2uEBaseCh + 1) % 2;
-//         A3uEBaseCh = ( A3uEBaseCh + 1) % 2;
-//         A4uEBaseCh = ( A4uEBaseCh + 1) % 2;
-        lAzim1BaseCh = (lAzim1BaseCh + 1) % 2;
-          lAziBaseCh = (  lAziBaseCh + 1) % 2;
-          uAziBaseCh = (  uAziBaseCh + 1) % 2;
-        uAzip1BaseCh = (uAzip1BaseCh + 1) % 2;
-        hrirCh = 1;
-        again = false;
-        goto AGAIN; // i love the goto
-    }
+        int i = 0;
+        while (i < neighbors.numNeighbors && (neighbors.rows[i] != row || neighbors.baseChs[i] != baseCh))
+            ++i;
+        if (i == neighbors.numNeighbors) {
+            neighbors.rows[i] = row;
+            neighbors.baseChs[i] = baseCh;
+            ++neighbors.numNeighbors;
+        }
+        neighbors.terms[numTerms++] = i;
+    };
+    // (in-region/nearby)(inner/outer)(azimuth/elevation)(plus/minus) in the same order that interpolateHRIR() weights them
+    add(niRuAE1,  nuAE1BaseCh);  add(niRuAE2,  nuAE2BaseCh);  add(niRuAE3,  nuAE3BaseCh);  add(niRuAE4,  nuAE4BaseCh);
+    add( iRuAE1,   uAE1BaseCh);  add( iRuAE2,   uAziBaseCh);  add( iRuAE3,   uAziBaseCh);  add( iRuAE4,   uAE4BaseCh);
+    add(niRlAE1,  nlAE1BaseCh);  add(niRlAE2,  nlAE2BaseCh);  add(niRlAE3,  nlAE3BaseCh);  add(niRlAE4,  nlAE4BaseCh);
+    add( iRlAE1,   lAE1BaseCh);  add( iRlAE2,   lAziBaseCh);  add( iRlAE3,   lAziBaseCh);  add( iRlAE4,   lAE4BaseCh);
+    add(noRuAE1,  nuAE1BaseCh);  add(noRuAE2,  nuAE2BaseCh);  add(noRuAE3,  nuAE3BaseCh);  add(noRuAE4,  nuAE4BaseCh);
+    add( oRuAE1,   uAE1BaseCh);  add( oRuAE2,   uAziBaseCh);  add( oRuAE3,   uAziBaseCh);  add( oRuAE4,   uAE4BaseCh);
+    add(noRlAE1,  nlAE1BaseCh);  add(noRlAE2,  nlAE2BaseCh);  add(noRlAE3,  nlAE3BaseCh);  add(noRlAE4,  nlAE4BaseCh);
+    add( oRlAE1,   lAE1BaseCh);  add( oRlAE2,   lAziBaseCh);  add( oRlAE3,   lAziBaseCh);  add( oRlAE4,   lAE4BaseCh);
+    
+    add(niRA1uE,  nA1uEBaseCh);  add(niRA2uE,  nA2uEBaseCh);  add(niRA3uE,  nA3uEBaseCh);  add(niRA4uE,  nA4uEBaseCh);
+    add( iRA1uE, lAzim1BaseCh);  add( iRA2uE,   lAziBaseCh);  add( iRA3uE,   uAziBaseCh);  add( iRA4uE, uAzip1BaseCh);
+    add(niRA1lE,  nA1lEBaseCh);  add(niRA2lE,  nA2lEBaseCh);  add(niRA3lE,  nA3lEBaseCh);  add(niRA4lE,  nA4lEBaseCh);
+    add( iRA1lE, lAzim1BaseCh);  add( iRA2lE,   lAziBaseCh);  add( iRA3lE,   uAziBaseCh);  add( iRA4lE, uAzip1BaseCh);
+    add(noRA1uE,  nA1uEBaseCh);  add(noRA2uE,  nA2uEBaseCh);  add(noRA3uE,  nA3uEBaseCh);  add(noRA4uE,  nA4uEBaseCh);
+    add( oRA1uE, lAzim1BaseCh);  add( oRA2uE,   lAziBaseCh);  add( oRA3uE,   uAziBaseCh);  add( oRA4uE, uAzip1BaseCh);
+    add(noRA1lE,  nA1lEBaseCh);  add(noRA2lE,  nA2lEBaseCh);  add(noRA3lE,  nA3lEBaseCh);  add(noRA4lE,  nA4lEBaseCh);
+    add( oRA1lE, lAzim1BaseCh);  add( oRA2lE,   lAziBaseCh);  add( oRA3lE,   uAziBaseCh);  add( oRA4lE, uAzip1BaseCh);
+    neighbors.cell = cell;
 }
 
 //// PRE CONCURRENTRESOURCE
@@ -30,6 +30,8 @@
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "DrewLib.h"
 #include "Doppler.h"
+#include "Convolver.h"
+#include "HRIRTable.h"
 #include "Interpolator.h"
 #include "Data.h"
 #include "StackArray.h"
@@ -64,8 +66,8 @@ public:
     // create an interp from its saved XML state
     std::unique_ptr<Interpolator<float>> getInterpolator(const XmlElement& interpXML) const;
     // bounds checking for where the source/path pts can exist
-    void boundsCheckRAE(std::array<float, 3>& rae, float& eleDirection) noexcept;
-    void boundsCheckRAE(float (&rae)[3], float& eleDirection) noexcept;
+    static void boundsCheckRAE(std::array<float, 3>& rae, float& eleDirection) noexcept;
+    static void boundsCheckRAE(float (&rae)[3], float& eleDirection) noexcept;
     void boundsCheckXYZ(std::array<float, 3>& xyz);
     // control source position with rae coordinate
     void setPosRAE(std::array<float, 3>& rae);
@@ -80,6 +82,11 @@ public:
     std::array<float, 3> getPosXYZ() const;
     // set the source position given a time, playing state, and previous pathPos index from the realtime processing thread
     bool setParametricPosition(float posSec, int& prevPathPosIndex, float parametricPositionFromDAW = -1);
+    // get the position the source will be at on its path at a time without moving it there, returns false if the source has no path or no path automation at that time
+    bool getParametricPosition(float posSec, int& pathPosIndex, std::array<float, 3>& rae) const;
+    // get the position and muted state that setParametricPosition() would give the source without changing it, for the realtime processing thread to read the source from a snapshot.
+    // returns false (leaving rae and muted as they are) if the source is not on a path, rae is also left as it is if the path has no position at that time
+    bool getParametricPosition(float posSec, int& prevPathPosIndex, float parametricPositionFromDAW, std::array<float, 3>& rae, bool& muted) const;
     void setPositionUpdate(const std::array<float, 3>& newPosRAE, bool newMuted);
     // control if the source is selected for editing
     void setSourceSelected(bool newSourceSelected) noexcept;
@@ -180,15 +187,70 @@ typedef struct _Input_ {
 //    }
 //} Input;
 
+// a mono input history to convolve with hrirs, the current buffer and as much of the input before it as the hrirs and the fft engine reach back over
+class InputHistory
+{
+public:
+    // need to know this to allocate enough history for the longest buffer and the hrir length
+    void allocateForMaxBufferSize(int N_max);
+    // clear the input history
+    void reset() noexcept;
+    // add a buffer of input to the history, transforming it for the fft engine if transform is set (the spectra start over after buffers that were not)
+    void load(const float* dataIn, int N, bool transform) noexcept;
+    // done processing the current buffer
+    void advance() noexcept;
+    // the current buffer's samples within the circular history, which is mirrored (getBufferSize() samples written twice) for convolveMirrored()
+    const float* getBuffer() const noexcept { return &inputBuffer[0]; }
+    int getBufferSize() const noexcept { return inputBufferSize; }
+    int getOutPos() const noexcept { return inputBufferOutPos; }
+    int getN() const noexcept { return N; }
+    const ConvolverInput& getConvolverInput() const noexcept { return convolverInput; }
+protected:
+    int Nmax = 0;
+private:
+    int N = 0;
+	std::vector<float> inputBuffer;
+    int inputBufferSize = 0;
+	int inputBufferInPos = 0;
+	int inputBufferOutPos = 0;
+    ConvolverInput convolverInput;
+    bool transformed = false;
+};
+
+// the mono input history that all of the sources convolve, kept once per processBlock() instead of once per source.
+// it advances with every buffer whether or not any source is muted, so a source that is unmuted convolves the input that was really there rather than what it last heard
+class SourceInput : public InputHistory
+{
+public:
+    void allocateForMaxBufferSize(int N_max);
+    // select the algorithm the sources use to convolve the input with their hrirs
+    void setConvolutionEngine(ConvolutionEngine newEngine) noexcept { convolutionEngine = newEngine; }
+    // keep the longer input history that the sources' fractional delay doppler effects read, its memory is allocated and freed in the background
+    void setDopplerOn(bool newDopplerOn) noexcept;
+    void setDopplerSampleRate(float sampleRate) noexcept;
+    DopplerDelayLine& getDopplerDelayLine() noexcept { return dopplerDelayLine; }
+    ConvolutionEngine getConvolutionEngine() const noexcept { return convolutionEngine; }
+    void reset() noexcept;
+    // add a buffer of input to the history (and transform it for the fft engine, even when no source convolves it, so that its spectra stay complete) before the sources process it
+    void load(const float* dataIn, int N) noexcept;
+private:
+    ConvolutionEngine convolutionEngine = ConvolutionEngine::PARTITIONED_FFT;
+    bool dopplerOn = false;
+    DopplerDelayLine dopplerDelayLine;
+};
+
 // holds the information needed for producing audio for a SoundSource
 class PlayableSoundSource
 {
+    friend class StationarySources;
 public:
     PlayableSoundSource();
     ~PlayableSoundSource();
     void advancePosition() noexcept;
     // update the PlayableSoundSource with the state of a SoundSource
     void updateFromSoundSource(const SoundSource& source) noexcept;
+    // or with just a position and muted state
+    void setPosition(const std::array<float, 3>& rae, bool muted) noexcept;
     std::array<float,3> getPosRAE() const noexcept;
     // need to know this to allocate enough temp storage for intermediate audio processing
     void allocateForMaxBufferSize(int N_max);
@@ -196,34 +258,51 @@ public:
 //    void setRealTime(bool isRealTime) noexcept;
 //    bool getRealTime() const noexcept;
     // control Doppler effect
-    void setDopplerOn(bool newDopplerOn, float newSpeedOfSound);
+    // with the fractional delay engine, mono applies one doppler delay for the center of the head to the source's input and leaves the interaural time difference to the hrir, which halves its cost
+    void setDopplerOn(bool newDopplerOn, float newSpeedOfSound, DopplerEngine newEngine = DopplerEngine::SCATTER, bool mono = false);
     void setDopplerSampleRate(float sampleRate) noexcept;
     // control if the source is processing audio or not
     void setSourceMuted(bool newMutedState) noexcept;
     bool getSourceMuted() const noexcept;
-    // audio/hrir processing
-    void interpolateHRIR(const float* rae, float* hrir) const noexcept;
+    // audio/hrir processing, the hrir comes out already normalized (see normalizeHRIR()) with its scaling factors in scaling[2]
+    void interpolateHRIR(const float* rae, float* hrir, float* scaling) const noexcept;
+    // set the hrir for the current position without blending from the previous one, needs the hrir data
+    void resetHRIR() noexcept;
+    // start loading the hrir data around a position the source is about to move to into the cpu cache, does nothing if that region of the data was just prefetched
+    void prefetchHRIRs(const std::array<float, 3>& rae) noexcept;
+    // the hrir data to use, the source can't be processed until it has some
+    void setHRIRTable(const HRIRTable* newHRIRdata) noexcept;
     //void processAudioRealTime(const float* dataTime, int N, float* sourceOutput);
     //void interpolateHRIR(const std::array<float,3>& rae, float* hrir) const;
     void resetProcessingState() noexcept;
-    void processAudio(const float* dataIn, int N, float* dataOut, const bool realTime);
+    void processAudio(SourceInput& input, float* dataOut, const bool realTime);
     // for efficiently remembering the last accessed index of the pathPos interp
     int prevPathPosIndex = 0;
+    // same for looking ahead on the path
+    int lookaheadPathPosIndex = 0;
 private:
     // for the doppler effect
     bool dopplerOn = false;
+    DopplerEngine dopplerEngine = DopplerEngine::SCATTER;
+    bool dopplerMono = false;
     Doppler doppler[2];
-    float dopplerMaxDistance = 20; // 20 meters is good to start with
+    float dopplerMaxDistance = defaultDopplerMaxDistance;
     float dopplerSpeedOfSound = defaultSpeedOfSound;
+    // the fractional delay doppler effect delays each ear's input before it is convolved, so each ear convolves the history of its own input read from the shared input's delay line instead of the shared input (in mono, both ears convolve the first one).
+    // they are only loaded (and transformed for the fft engine) while that doppler effect is on
+    InputHistory dopplerInputs[2];
+    float earToSourceDistance(int ch) const noexcept;
     //bool dopplerMaxDistanceChanged = false;
     // to hold previous buffer(s)'s inputs for computing convolution tails
     //std::vector<Input> inputs;
     //int newInputIndex = 0;
     int Nmax = 0;
 	
-	std::vector<float> inputBuffer;
-	int inputBufferInPos = 0;
-	int inputBufferOutPos = 0;
+    // the (shared) hrir data
+    const HRIRTable* HRIRdata = nullptr;
+    // for the partitioned fft convolution engine, filters 0/1 are the current hrir's channels and 2/3 are the next hrir's channels when blending
+    PartitionedConvolver convolver;
+    bool HRIRSpectraValid = false; // are filters 0/1 up to date with HRIR
 
     //Array<Input*> inputs;
     std::array<float,3> posRAE {1, 0, M_PI/2};
@@ -248,18 +327,61 @@ private:
     bool HRIRChange = false; // indicates if there was change in position since the last processesing buffer
     int numHRIRs = 2;
     std::array<float, 2*numTimeSteps> HRIR {0};
+    unsigned int HRIRVersion = 0; // incremented whenever HRIR or its scaling changes
     std::array<float, 4*numTimeSteps> HRIRs {0};
     float HRIRScaling[4] {1.0};
 	std::vector<float> hqHRIRs;
 	std::vector<float> hqHRIRScaling;
+    // time reversed and interleaved copies of HRIR and the blended hrirs for the simd time domain convolution
+    std::array<float, 2*numTimeSteps> HRIRInterleaved {0};
+    std::vector<float> HRIRsInterleaved;
     /*float* hqHRIRs = nullptr;
     float* hqHRIRScaling = nullptr;
     float* temp = nullptr;*/
     int prevTempSize = 0;
+    // the distinct neighboring hrirs that interpolateHRIR() sums for the region of the hrir data's grid that the source was last in,
+    // which only need to be found again when the source moves to another region (or the other side of one)
+    struct HRIRNeighbors
+    {
+        std::array<int, 5> cell {{0}}; // see findHRIRNeighbors()
+        int numNeighbors = 0; // 0 if they need to be found
+        std::array<const float*, 64> rows;
+        std::array<int, 64> baseChs; // which of each row's channels is the left one
+        std::array<int, 64> terms; // the neighbor that each of the interpolation's 64 terms weights
+    };
+    mutable HRIRNeighbors HRIRNeighborCache;
+    void findHRIRNeighbors(const std::array<int, 5>& cell, HRIRNeighbors& neighbors) const noexcept;
+    // the regions most recently prefetched by prefetchHRIRs()
+    std::array<std::array<int, 5>, 4> prefetchedCells {{{{-1}}, {{-1}}, {{-1}}, {{-1}}}};
+    int nextPrefetchedCell = 0;
 //    // affects the degree to which the processing routine can smoothly blend between different hrirs at different positions
 //    bool realTime = true;
 };
 
+// all of the sources share the same input, so the stationary ones can be processed together as one source whose hrir is the sum of theirs
+class StationarySources
+{
+public:
+    // pre-allocate space for the maximum number of sources that can be summed
+    void allocate(int maxNumSources);
+    // start gathering the stationary sources for a new buffer
+    void clear() noexcept;
+    // add the source to the sum if it is stationary, returns false if it has to be processed on its own with PlayableSoundSource::processAudio()
+    bool add(PlayableSoundSource& source) noexcept;
+    // convolve the input with the summed hrir of the sources added since clear(), only resumming the hrirs when one of the sources changed
+    void processAudio(const SourceInput& input, float* dataOut);
+private:
+    // the sources in the sum and the HRIRVersion each had when it was added
+    std::vector<std::pair<const PlayableSoundSource*, unsigned int>> sources;
+    std::vector<std::pair<const PlayableSoundSource*, unsigned int>> prevSources;
+    // normalized sum of the sources' scaled hrirs, see PlayableSoundSource::processAudio() for why it is normalized
+    std::array<float, 2*numTimeSteps> HRIR {0};
+    std::array<float, 2*numTimeSteps> HRIRInterleaved {0};
+    float HRIRScaling[2] {0};
+    PartitionedConvolver convolver;
+    bool HRIRSpectraValid = false;
+};
+
 #endif /* defined(__SoundSource__) */
 
 
@@ -0,0 +1,294 @@
+//
+//  BuildCompressedHRIRs.cpp
+//  ThreeDAudio
+//
+//
+/*
+     3DAudio: simulates surround sound audio for headphones
+     Copyright (C) 2016  Andrew Barker
+
+     This program is free software: you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation, either version 3 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+     The author can be contacted via email at andrew.barker.12345@gmail.com.
+ */
+
+// offline builder of the compressed hrir tables (3DAudioDataCompressed.hrir) that the plugin uses instead of the full one if one is next to 3DAudioData.bin. there are two kinds:
+// - principal components: every hrir channel in the data is approximated by a weighted sum of the same few basis hrirs, the principal components (of the uncentered data) that capture the most energy.
+//   the plugin then interpolates these weights instead of the hrirs' taps and reconstructs the hrir from the basis once, and the table shrinks by numTimeSteps/numComponents.
+// - distance factorized: only the farthest distance's hrirs are kept, and every hrir channel at the other distances is approximated by the far field hrir of its direction through a short correction filter
+//   (the least squares fit of numCorrectionTaps taps, 1 tap being just a gain), which the plugin interpolates radially instead of the hrirs. the table shrinks by about numDistanceSteps/(1 + numDistanceSteps*numCorrectionTaps/numTimeSteps).
+//
+// build:  c++ -std=c++14 -O2 BuildCompressedHRIRs.cpp -o BuildCompressedHRIRs
+// usage:  BuildCompressedHRIRs 3DAudioData.bin 3DAudioDataCompressed.hrir [numComponents (default 16)]
+//         BuildCompressedHRIRs -distance 3DAudioData.bin 3DAudioDataCompressed.hrir [numCorrectionTaps (default 2)]
+
+#include "../HRIRTableFile.h"
+#include <vector>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <algorithm>
+#include <numeric>
+#include <string>
+
+// eigen decomposition of the symmetric matrix a (n x n, destroyed) with the cyclic jacobi method, eigenvectors go in the columns of v
+static void eigenSymmetric(std::vector<double>& a, const int n, std::vector<double>& eigenvalues, std::vector<double>& v)
+{
+    v.assign(n*n, 0);
+    for (int i = 0; i < n; ++i)
+        v[i*n+i] = 1;
+    for (int sweep = 0; sweep < 100; ++sweep) {
+        double offDiagonal = 0;
+        for (int p = 0; p < n; ++p)
+            for (int q = p+1; q < n; ++q)
+                offDiagonal += a[p*n+q] * a[p*n+q];
+        if (offDiagonal < 1e-22)
+            break;
+        for (int p = 0; p < n; ++p) {
+            for (int q = p+1; q < n; ++q) {
+                if (a[p*n+q] == 0)
+                    continue;
+                const double theta = (a[q*n+q] - a[p*n+p]) / (2 * a[p*n+q]);
+                const double t = (theta >= 0 ? 1 : -1) / (std::abs(theta) + std::sqrt(theta*theta + 1));
+                const double c = 1 / std::sqrt(t*t + 1);
+                const double s = t * c;
+                for (int k = 0; k < n; ++k) { // a = a * rotation
+                    const double akp = a[k*n+p], akq = a[k*n+q];
+                    a[k*n+p] = c*akp - s*akq;
+                    a[k*n+q] = s*akp + c*akq;
+                }
+                for (int k = 0; k < n; ++k) { // a = rotation^T * a
+                    const double apk = a[p*n+k], aqk = a[q*n+k];
+                    a[p*n+k] = c*apk - s*aqk;
+                    a[q*n+k] = s*apk + c*aqk;
+                }
+                for (int k = 0; k < n; ++k) {
+                    const double vkp = v[k*n+p], vkq = v[k*n+q];
+                    v[k*n+p] = c*vkp - s*vkq;
+                    v[k*n+q] = s*vkp + c*vkq;
+                }
+            }
+        }
+    }
+    eigenvalues.resize(n);
+    for (int i = 0; i < n; ++i)
+        eigenvalues[i] = a[i*n+i];
+}
+
+// read the hrirs into the full table's row layout (see HRIRTableFile.h)
+static bool readHRIRs(const char* fileName, const HRIRTableFileHeader& header, std::vector<float>& rows)
+{
+    const int T = numTimeSteps;
+    rows.assign(std::size_t(header.numDistances) * header.rowsPerDistance * 2 * T, 0.0f);
+    std::ifstream is (fileName, std::ios::binary);
+    for (int d = 0; d < header.numDistances; ++d)
+        is.read((char*)&rows[std::size_t(d) * header.rowsPerDistance * 2 * T], std::size_t(header.rowsPerDistance - 2) * 2 * T * sizeof(float));
+    for (int d = 0; d < header.numDistances; ++d) {
+        for (int p = 0; p < 2; ++p) { // pole data is the same for both channels
+            float* pole = &rows[(std::size_t(d) * header.rowsPerDistance + header.rowsPerDistance - 2 + p) * 2 * T];
+            is.read((char*)pole, T * sizeof(float));
+            std::copy_n(pole, T, &pole[T]);
+        }
+    }
+    return bool(is);
+}
+
+static bool writeTable(const char* fileName, const HRIRTableFileHeader& header, const std::vector<float>& first, const std::vector<float>& second, const std::vector<float>& norms)
+{
+    std::ofstream os (fileName, std::ios::binary);
+    os.write((const char*)&header, sizeof(header));
+    os.write((const char*)first.data(), first.size() * sizeof(float));
+    os.write((const char*)second.data(), second.size() * sizeof(float));
+    os.write((const char*)norms.data(), norms.size() * sizeof(float));
+    return bool(os);
+}
+
+static float l1Norm(const float* hrir)
+{
+    float norm = 0;
+    for (int n = 0; n < numTimeSteps; ++n)
+        norm += std::abs(hrir[n]);
+    return norm;
+}
+
+static void compress(const std::vector<float>& rows, const int numComponents, std::vector<float>& basis, std::vector<float>& weights, std::vector<float>& norms)
+{
+    // both channels of every hrir share the basis, because the data's channels get swapped for the other azimuth side
+    const int T = numTimeSteps;
+    const std::size_t numHRIRs = rows.size() / T;
+    std::vector<double> correlation (T*T, 0);
+    for (std::size_t h = 0; h < numHRIRs; ++h) {
+        const float* x = &rows[h*T];
+        for (int i = 0; i < T; ++i)
+            for (int j = i; j < T; ++j)
+                correlation[i*T+j] += double(x[i]) * x[j];
+    }
+    for (int i = 0; i < T; ++i)
+        for (int j = 0; j < i; ++j)
+            correlation[i*T+j] = correlation[j*T+i];
+    std::vector<double> eigenvalues, eigenvectors;
+    eigenSymmetric(correlation, T, eigenvalues, eigenvectors);
+    std::vector<int> order (T);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&eigenvalues] (int a, int b) { return eigenvalues[a] > eigenvalues[b]; });
+    basis.resize(numComponents * T);
+    for (int k = 0; k < numComponents; ++k)
+        for (int n = 0; n < T; ++n)
+            basis[k*T+n] = (float)eigenvectors[n*T+order[k]];
+    
+    // each hrir channel's weights are its projection onto the (orthonormal) basis
+    weights.resize(numHRIRs * numComponents);
+    norms.resize(numHRIRs);
+    double energy = 0, error = 0;
+    std::vector<float> reconstructed (T);
+    for (std::size_t h = 0; h < numHRIRs; ++h) {
+        const float* x = &rows[h*T];
+        float* w = &weights[h*numComponents];
+        std::fill(reconstructed.begin(), reconstructed.end(), 0.0f);
+        for (int k = 0; k < numComponents; ++k) {
+            double dot = 0;
+            for (int n = 0; n < T; ++n)
+                dot += double(x[n]) * basis[k*T+n];
+            w[k] = (float)dot;
+            for (int n = 0; n < T; ++n)
+                reconstructed[n] += w[k] * basis[k*T+n];
+        }
+        for (int n = 0; n < T; ++n) {
+            energy += double(x[n]) * x[n];
+            error += double(x[n] - reconstructed[n]) * (x[n] - reconstructed[n]);
+        }
+        norms[h] = l1Norm(&reconstructed[0]);
+    }
+    std::printf("%d components, reconstruction error %.2f dB relative to the hrirs' energy\n", numComponents, 10 * std::log10(error / energy));
+}
+
+// the least squares fit of the numTaps tap filter c so that c * farField (truncated to numTimeSteps) approximates hrir, returns the squared error and the approximation's L1 norm
+static double fitCorrection(const float* farField, const float* hrir, const int numTaps, float* c, float& norm)
+{
+    const int T = numTimeSteps;
+    double a[HRIRTableFileMaxCorrectionTaps][HRIRTableFileMaxCorrectionTaps+1]; // normal equations, right hand side in the last column
+    double trace = 0;
+    for (int i = 0; i < numTaps; ++i) {
+        for (int j = 0; j < numTaps; ++j) {
+            a[i][j] = 0;
+            for (int n = std::max(i, j); n < T; ++n)
+                a[i][j] += double(farField[n-i]) * farField[n-j];
+        }
+        a[i][numTaps] = 0;
+        for (int n = i; n < T; ++n)
+            a[i][numTaps] += double(hrir[n]) * farField[n-i];
+        trace += a[i][i];
+    }
+    for (int i = 0; i < numTaps; ++i)
+        a[i][i] += 1e-9 * trace + 1e-30;
+    // gaussian elimination with partial pivoting
+    for (int i = 0; i < numTaps; ++i) {
+        int pivot = i;
+        for (int r = i+1; r < numTaps; ++r)
+            if (std::abs(a[r][i]) > std::abs(a[pivot][i]))
+                pivot = r;
+        for (int k = 0; k <= numTaps; ++k)
+            std::swap(a[i][k], a[pivot][k]);
+        for (int r = i+1; r < numTaps; ++r) {
+            const double f = a[r][i] / a[i][i];
+            for (int k = i; k <= numTaps; ++k)
+                a[r][k] -= f * a[i][k];
+        }
+    }
+    for (int i = numTaps-1; i >= 0; --i) {
+        double x = a[i][numTaps];
+        for (int k = i+1; k < numTaps; ++k)
+            x -= a[i][k] * c[k];
+        c[i] = float(x / a[i][i]);
+    }
+    double error = 0;
+    norm = 0;
+    for (int n = 0; n < T; ++n) {
+        float y = 0;
+        for (int t = 0; t < numTaps && t <= n; ++t)
+            y += c[t] * farField[n-t];
+        error += double(hrir[n] - y) * (hrir[n] - y);
+        norm += std::abs(y);
+    }
+    return error;
+}
+
+static void factorize(const std::vector<float>& rows, const HRIRTableFileHeader& header, std::vector<float>& farField, std::vector<float>& corrections, std::vector<float>& norms)
+{
+    const int T = numTimeSteps;
+    const int L = header.numCorrectionTaps;
+    const std::size_t farFieldRows = std::size_t(header.numDistances - 1) * header.rowsPerDistance * 2;
+    farField.assign(rows.begin() + farFieldRows * T, rows.end());
+    corrections.assign(std::size_t(header.numDistances) * header.rowsPerDistance * 2 * L, 0.0f);
+    norms.assign(header.getNumNorms(), 0.0f);
+    for (int d = 0; d < header.numDistances; ++d) {
+        double energy = 0, error = 0;
+        for (std::size_t h = 0; h < std::size_t(header.rowsPerDistance) * 2; ++h) {
+            const std::size_t i = std::size_t(d) * header.rowsPerDistance * 2 + h;
+            const float* x = &rows[i*T];
+            error += fitCorrection(&farField[h*T], x, L, &corrections[i*L], norms[i]);
+            for (int n = 0; n < T; ++n)
+                energy += double(x[n]) * x[n];
+        }
+        std::printf("distance %2d: reconstruction error %.2f dB relative to the hrirs' energy\n", d, 10 * std::log10(error / energy + 1e-30));
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const bool distanceFactorized = argc > 1 && std::string(argv[1]) == "-distance";
+    if (distanceFactorized) {
+        ++argv;
+        --argc;
+    }
+    if (argc < 3) {
+        std::fprintf(stderr, "usage: %s [-distance] 3DAudioData.bin 3DAudioDataCompressed.hrir [numComponents or numCorrectionTaps]\n", argv[0]);
+        return 1;
+    }
+    HRIRTableFileHeader header;
+    const int size = argc > 3 ? std::atoi(argv[3]) : distanceFactorized ? 2 : 16;
+    if (distanceFactorized) {
+        if (size < 1 || size > HRIRTableFileMaxCorrectionTaps) {
+            std::fprintf(stderr, "numCorrectionTaps must be from 1 to %d\n", HRIRTableFileMaxCorrectionTaps);
+            return 1;
+        }
+        header.numCorrectionTaps = size;
+    } else {
+        if (size < 1 || size > numTimeSteps) {
+            std::fprintf(stderr, "numComponents must be from 1 to %d\n", numTimeSteps);
+            return 1;
+        }
+        header.numComponents = size;
+    }
+    
+    std::vector<float> rows;
+    if (!readHRIRs(argv[1], header, rows)) {
+        std::fprintf(stderr, "could not read the hrir data from %s\n", argv[1]);
+        return 1;
+    }
+    std::vector<float> first, second, norms;
+    if (distanceFactorized)
+        factorize(rows, header, first, second, norms);
+    else
+        compress(rows, header.numComponents, first, second, norms);
+    std::printf("%.1f MB -> %.1f MB\n", rows.size() * sizeof(float) / 1e6, header.getDataSize() * sizeof(float) / 1e6);
+    
+    if (!writeTable(argv[2], header, first, second, norms)) {
+        std::fprintf(stderr, "could not write %s\n", argv[2]);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,211 @@
+//
+//  CheckConvolutionEngines.cpp
+//  ThreeDAudio
+//
+//
+/*
+     3DAudio: simulates surround sound audio for headphones
+     Copyright (C) 2016  Andrew Barker
+
+     This program is free software: you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation, either version 3 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+     The author can be contacted via email at andrew.barker.12345@gmail.com.
+ */
+
+// offline check that the two convolution engines the sources can use give the same output, and of what each costs.
+// white noise is fed through a mirrored circular input buffer the way InputHistory does it, in blocks of a fixed size and then of sizes that change every block,
+// and convolved with a random hrir pair by both the time domain kernels (convolveMirrored) and the partitioned fft (ConvolverInput + PartitionedConvolver).
+// the largest difference between them, and between each of them and a plain direct convolution, relative to the peak output, must be within 1e-5.
+// the cost per block of each engine is reported for blocks of 32, 64 and 128 samples.
+//
+// build:  c++ -std=c++14 -O2 CheckConvolutionEngines.cpp ../Convolver.cpp ../ConvolutionKernels.cpp -o CheckConvolutionEngines
+// usage:  CheckConvolutionEngines   (exits with 1 if the engines differ by more than the tolerance)
+
+#include "../Convolver.h"
+#include "../ConvolutionKernels.h"
+#include "../Data.h"
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+static constexpr float tolerance = 1e-5f;
+
+// the input history of one source, as kept by InputHistory
+struct History
+{
+    explicit History(const int Nmax)
+        : size (std::max<int>(Nmax * (std::ceil(float(numTimeSteps - 1) / float(Nmax)) + 1),
+                              Nmax + 2 * convolutionPartitionSize)),
+          buffer (2 * size, 0.0f)
+    {
+        spectra.allocate(Nmax, numTimeSteps, convolutionPartitionSize);
+    }
+    void load(const float* x, const int numSamples, const bool transform)
+    {
+        N = numSamples;
+        for (int n = 0; n < N; ++n) {
+            buffer[inPos] = buffer[inPos + size] = x[n];
+            inPos = (inPos + 1) % size;
+        }
+        if (transform)
+            spectra.transform(&buffer[0], outPos, size, N);
+    }
+    void advance() { outPos = (outPos + N) % size; }
+    const int size;
+    std::vector<float> buffer;
+    ConvolverInput spectra;
+    int inPos = 0, outPos = 0, N = 0;
+};
+
+struct Engines
+{
+    explicit Engines(const std::vector<float>& hrir)
+        : interleaved (2 * numTimeSteps)
+    {
+        interleaveHRIRs(&hrir[0], numTimeSteps, 1, &interleaved[0]);
+        convolver.allocate(numTimeSteps, convolutionPartitionSize, 2);
+        convolver.setFilter(0, &hrir[0]);
+        convolver.setFilter(1, &hrir[numTimeSteps]);
+    }
+    void timeDomain(const History& in, float* y) const noexcept
+    {
+        convolveMirrored(&in.buffer[0], in.outPos, in.size, &interleaved[0], numTimeSteps, scales, y, y + in.N, in.N);
+    }
+    void fft(const History& in, float* y) noexcept
+    {
+        for (int ch = 0; ch < 2; ++ch)
+            convolver.process(in.spectra, ch, y + ch*in.N);
+    }
+    std::vector<float> interleaved;
+    PartitionedConvolver convolver;
+    const float scales[2] {1, 1};
+};
+
+// largest differences, relative to the peak of the direct convolution, of the two engines over numBlocks blocks of the sizes given by blockSize(block)
+template <class BlockSize>
+static void compare(const std::vector<float>& hrir, const int Nmax, const int numBlocks, BlockSize blockSize,
+                    float& fftVsTimeDomain, float& timeDomainVsDirect, float& fftVsDirect)
+{
+    std::mt19937 rng (1);
+    std::uniform_real_distribution<float> noise (-1, 1);
+    std::vector<float> x;
+    std::vector<int> sizes;
+    for (int b = 0; b < numBlocks; ++b) {
+        sizes.push_back(blockSize(b, rng));
+        for (int n = 0; n < sizes.back(); ++n)
+            x.push_back(noise(rng));
+    }
+    History history (Nmax);
+    Engines engines (hrir);
+    std::vector<float> yTD (2*Nmax), yFFT (2*Nmax);
+    float peak = 0, maxFFTvsTD = 0, maxTDvsDirect = 0, maxFFTvsDirect = 0;
+    int begin = 0;
+    for (const int N : sizes) {
+        history.load(&x[begin], N, true);
+        engines.timeDomain(history, &yTD[0]);
+        engines.fft(history, &yFFT[0]);
+        history.advance();
+        for (int ch = 0; ch < 2; ++ch) {
+            for (int n = 0; n < N; ++n) {
+                double direct = 0;
+                for (int k = 0; k < numTimeSteps && k <= begin + n; ++k)
+                    direct += double(hrir[ch*numTimeSteps + k]) * x[begin + n - k];
+                const float td = yTD[ch*N + n], f = yFFT[ch*N + n];
+                peak = std::max(peak, std::abs(float(direct)));
+                maxFFTvsTD = std::max(maxFFTvsTD, std::abs(f - td));
+                maxTDvsDirect = std::max(maxTDvsDirect, std::abs(td - float(direct)));
+                maxFFTvsDirect = std::max(maxFFTvsDirect, std::abs(f - float(direct)));
+            }
+        }
+        begin += N;
+    }
+    fftVsTimeDomain = maxFFTvsTD / peak;
+    timeDomainVsDirect = maxTDvsDirect / peak;
+    fftVsDirect = maxFFTvsDirect / peak;
+}
+
+// microseconds per block of N samples for each engine, the fft's including the transform of its input
+static void measure(const std::vector<float>& hrir, const int N, double& timeDomainMicroseconds, double& fftMicroseconds)
+{
+    const int numBlocks = 200000 / N;
+    std::mt19937 rng (2);
+    std::uniform_real_distribution<float> noise (-1, 1);
+    std::vector<float> x (N * numBlocks);
+    for (auto& s : x)
+        s = noise(rng);
+    std::vector<float> y (2*N);
+    float sink = 0;
+    using clock = std::chrono::steady_clock;
+    for (int engine = 0; engine < 2; ++engine) {
+        History history (N);
+        Engines engines (hrir);
+        const auto start = clock::now();
+        for (int b = 0; b < numBlocks; ++b) {
+            history.load(&x[b*N], N, engine == 1);
+            if (engine == 0)
+                engines.timeDomain(history, &y[0]);
+            else
+                engines.fft(history, &y[0]);
+            history.advance();
+            sink += y[N-1];
+        }
+        const double us = std::chrono::duration<double, std::micro>(clock::now() - start).count() / numBlocks;
+        (engine == 0 ? timeDomainMicroseconds : fftMicroseconds) = us;
+    }
+    if (sink == 12345)
+        std::printf(" ");
+}
+
+int main()
+{
+    std::printf("convolution kernels: %s, hrir length %d, fft partition size %d\n\n",
+                getConvolutionKernelsName(), numTimeSteps, convolutionPartitionSize);
+    // a decaying random hrir pair
+    std::mt19937 rng (0);
+    std::normal_distribution<float> gauss;
+    std::vector<float> hrir (2 * numTimeSteps);
+    for (int n = 0; n < numTimeSteps; ++n) {
+        hrir[n] = gauss(rng) * std::exp(-n / 20.0f);
+        hrir[numTimeSteps + n] = gauss(rng) * std::exp(-n / 30.0f);
+    }
+    bool pass = true;
+    std::printf("largest difference relative to the peak output (tolerance %g):\n", tolerance);
+    std::printf("%-28s %14s %14s %14s\n", "blocks", "fft vs time", "time vs direct", "fft vs direct");
+    const auto report = [&] (const char* name, const int Nmax, auto blockSize)
+    {
+        float a, b, c;
+        compare(hrir, Nmax, 300, blockSize, a, b, c);
+        const bool ok = a <= tolerance && b <= tolerance && c <= tolerance;
+        pass = pass && ok;
+        std::printf("%-28s %14.3g %14.3g %14.3g%s\n", name, a, b, c, ok ? "" : "   FAIL");
+    };
+    for (const int N : {1, 32, 64, 100, 128, 512}) {
+        char name[64];
+        std::snprintf(name, sizeof(name), "%d samples", N);
+        report(name, N, [N] (int, std::mt19937&) { return N; });
+    }
+    report("1 to 512 samples, varying", 512, [] (int, std::mt19937& r) { return std::uniform_int_distribution<int>(1, 512)(r); });
+    std::printf("\nmicroseconds per block for one source's two ears:\n");
+    std::printf("%-10s %14s %14s\n", "block", "time domain", "fft");
+    for (const int N : {32, 64, 128}) {
+        double td, fft;
+        measure(hrir, N, td, fft);
+        std::printf("%-10d %14.3f %14.3f\n", N, td, fft);
+    }
+    std::printf("\n%s\n", pass ? "engines agree" : "ENGINES DIFFER");
+    return pass ? 0 : 1;
+}
@@ -0,0 +1,236 @@
+//
+//  MeasureMonoDoppler.cpp
+//  ThreeDAudio
+//
+//
+/*
+     3DAudio: simulates surround sound audio for headphones
+     Copyright (C) 2016  Andrew Barker
+
+     This program is free software: you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation, either version 3 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+     The author can be contacted via email at andrew.barker.12345@gmail.com.
+ */
+
+// offline measurement of how the mono doppler effect (one fractional delay for the center of the head, applied to a source's input before the hrir) differs from the per ear one (a fractional delay for each ear) that it halves the cost of.
+// both modes convolve with the same hrir, which carries the interaural time difference of the source's position, so the difference between them is just that of their delayed inputs. for a few source trajectories this reports:
+// - the interaural time difference the per ear mode adds on top of the hrir's, against the roughly 10 to 20 us that can just be heard (the mono mode adds none).
+// - the pitch difference between the ears (from their different doppler shifts) of the per ear mode, and of either ear from the mono mode's, against the roughly 5 cents that can just be heard.
+// - the level of the difference between the two modes' delayed inputs relative to the per ear one, for a low and a high tone and white noise, through the plugin's own delay line and doppler effect.
+//   this is mostly the added interaural time difference, which decorrelates the noise and the high tone (so more than about -10 dB only says the mono mode is not a close copy of the per ear one there).
+// - the cost of the doppler effect per block of each mode.
+//
+// build:  c++ -std=c++14 -O2 MeasureMonoDoppler.cpp ../Doppler.cpp -pthread -o MeasureMonoDoppler
+// usage:  MeasureMonoDoppler [sampleRate (default 44100)] [blockSize (default 64)] [speedOfSound (default 343)]
+
+#include "../Doppler.h"
+#include "../Data.h"
+#include <vector>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+
+using Position = std::array<double, 3>; // (x,y,z) in meters, in the plugin's coordinates (y is up, the ears are along z)
+
+// where a source is (in meters) at a time (in seconds)
+struct Trajectory
+{
+    const char* name;
+    std::function<Position(double)> position;
+};
+
+static Position earPosition(const int ch)
+{
+    // the same as the plugin's PlayableSoundSource::earToSourceDistance(), which gives earAzimuth and earElevation to RAEtoXYZ() as they are
+    const double azimuth = (ch == 0 ? earAzimuth : -earAzimuth), elevation = earElevation;
+    return {sphereRad * std::sin(elevation) * std::cos(azimuth),
+            sphereRad * std::cos(elevation),
+            sphereRad * std::sin(elevation) * std::sin(azimuth)};
+}
+
+static double distance(const Position& a, const Position& b)
+{
+    return std::sqrt((a[0]-b[0])*(a[0]-b[0]) + (a[1]-b[1])*(a[1]-b[1]) + (a[2]-b[2])*(a[2]-b[2]));
+}
+
+static double rmsLevel(const std::vector<float>& x, const std::size_t begin)
+{
+    double sum = 0;
+    for (std::size_t i = begin; i < x.size(); ++i)
+        sum += double(x[i]) * x[i];
+    return std::sqrt(sum / std::max<std::size_t>(x.size() - begin, 1));
+}
+
+// the distances (in meters) from the center of the head (ch = 2) and each ear to the source, at the end of each block as the plugin sees them
+static std::array<std::vector<float>, 3> blockDistances(const Trajectory& trajectory, const int numBlocks, const int blockSize, const double sampleRate)
+{
+    std::array<std::vector<float>, 3> distances;
+    const Position ears[2] {earPosition(0), earPosition(1)};
+    for (int b = 0; b < numBlocks; ++b) {
+        const Position p = trajectory.position(double((b+1) * blockSize) / sampleRate);
+        distances[0].push_back(float(distance(p, ears[0])));
+        distances[1].push_back(float(distance(p, ears[1])));
+        distances[2].push_back(float(distance(p, {0, 0, 0})));
+    }
+    return distances;
+}
+
+// delay the input block by block like the plugin does, to each of the distances (ch 0 and 1 for the ears, 2 for the center of the head)
+static std::array<std::vector<float>, 3> delayedInputs(const std::vector<float>& input, const std::array<std::vector<float>, 3>& distances,
+                                                       const int blockSize, const float sampleRate, const float speedOfSound)
+{
+    DopplerDelayLine delayLine;
+    delayLine.setSampleRate(sampleRate);
+    delayLine.allocate(defaultDopplerMaxDistance, blockSize, speedOfSound);
+    Doppler doppler[3];
+    std::array<std::vector<float>, 3> outputs;
+    for (int ch = 0; ch < 3; ++ch) {
+        doppler[ch].setSampleRate(sampleRate);
+        doppler[ch].setSpeedOfSound(speedOfSound);
+        outputs[ch].resize(input.size());
+    }
+    for (std::size_t b = 0; b < distances[0].size(); ++b) {
+        delayLine.write(&input[b * blockSize], blockSize);
+        for (int ch = 0; ch < 3; ++ch)
+            doppler[ch].process(distances[ch][b], blockSize, delayLine, &outputs[ch][b * blockSize]);
+    }
+    return outputs;
+}
+
+// the cost (in ns per block) of reading numReaders delays for a source
+static double dopplerCost(const int numReaders, const std::vector<float>& input, const std::array<std::vector<float>, 3>& distances,
+                          const int blockSize, const float sampleRate, const float speedOfSound)
+{
+    DopplerDelayLine delayLine;
+    delayLine.setSampleRate(sampleRate);
+    delayLine.allocate(defaultDopplerMaxDistance, blockSize, speedOfSound);
+    Doppler doppler[2];
+    for (auto& d : doppler) {
+        d.setSampleRate(sampleRate);
+        d.setSpeedOfSound(speedOfSound);
+    }
+    std::vector<float> output (blockSize);
+    const int numBlocks = int(distances[0].size());
+    const auto begin = std::chrono::steady_clock::now();
+    for (int b = 0; b < numBlocks; ++b) {
+        delayLine.write(&input[b * blockSize], blockSize);
+        for (int ch = 0; ch < numReaders; ++ch)
+            doppler[ch].process(distances[numReaders == 1 ? 2 : ch][b], blockSize, delayLine, &output[0]);
+    }
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - begin).count() / numBlocks;
+}
+
+int main(int argc, char* argv[])
+{
+    const float sampleRate = argc > 1 ? float(std::atof(argv[1])) : 44100.0f;
+    const int blockSize = argc > 2 ? std::atoi(argv[2]) : 64;
+    const float speedOfSound = argc > 3 ? float(std::atof(argv[3])) : defaultSpeedOfSound;
+    if (!(sampleRate > 0) || blockSize <= 0 || !(speedOfSound >= minDopplerSpeedOfSound)) {
+        std::fprintf(stderr, "usage: %s [sampleRate (default 44100)] [blockSize (default 64)] [speedOfSound (default 343)]\n", argv[0]);
+        return 1;
+    }
+    const double pi = 3.14159265358979323846;
+    const double seconds = 4;
+    const int numBlocks = int(seconds * sampleRate) / blockSize;
+    const std::size_t numSamples = std::size_t(numBlocks) * blockSize;
+    // the first blocks are left out of the measurements, while the delays ramp up from nothing
+    const std::size_t settled = std::size_t(std::min(numBlocks, int(0.1 * sampleRate) / blockSize + 2)) * blockSize;
+
+    // straight line fly-bys (at a speed in m/s, passing the head at a distance in m to its side, in front, or above) and circles around the head (at a radius in m and revolutions per second)
+    const auto flyBy = [seconds] (const double speed, const Position& closest, const Position& direction) {
+        return [=] (const double t) { const double s = speed * (t - seconds/2); return Position {closest[0] + s*direction[0], closest[1] + s*direction[1], closest[2] + s*direction[2]}; };
+    };
+    const auto circle = [pi] (const double radius, const double revolutionsPerSecond) {
+        return [=] (const double t) { const double a = 2 * pi * revolutionsPerSecond * t; return Position {radius * std::cos(a), 0, radius * std::sin(a)}; };
+    };
+    const Trajectory trajectories[] {
+        {"fly-by 10 m/s, 1 m to the side", flyBy(10, {0, 0, 1}, {1, 0, 0})},
+        {"fly-by 30 m/s, 1 m to the side", flyBy(30, {0, 0, 1}, {1, 0, 0})},
+        {"fly-by 30 m/s, 0.3 m to the side", flyBy(30, {0, 0, 0.3}, {1, 0, 0})},
+        {"fly-by 30 m/s, 1 m in front", flyBy(30, {1, 0, 0}, {0, 0, 1})},
+        {"fly-over 30 m/s, 1 m above", flyBy(30, {0, 1, 0}, {1, 0, 0})},
+        {"circle 1 m, 1 rev/s", circle(1, 1)},
+        {"circle 0.3 m, 2 rev/s", circle(0.3, 2)},
+        {"circle 2 m, 4 rev/s", circle(2, 4)},
+    };
+
+    // the test signals
+    std::vector<std::vector<float>> signals (3, std::vector<float>(numSamples));
+    const char* signalNames[] {"200 Hz", "4 kHz", "noise"};
+    std::mt19937 random (1);
+    std::uniform_real_distribution<float> uniform (-1, 1);
+    for (std::size_t n = 0; n < numSamples; ++n) {
+        signals[0][n] = float(std::sin(2 * pi * 200 * n / sampleRate));
+        signals[1][n] = float(std::sin(2 * pi * 4000 * n / sampleRate));
+        signals[2][n] = uniform(random);
+    }
+
+    std::printf("sample rate %g Hz, block size %d, speed of sound %g m/s\n\n", sampleRate, blockSize, speedOfSound);
+    std::printf("%-34s %21s %23s %12s  difference of the inputs (dB, left/right)\n", "", "added itd (us)", "pitch difference (cents)", "");
+    std::printf("%-34s %10s %10s %11s %11s %12s  %-13s %-13s %-13s\n", "trajectory", "max", "change/s", "interaural", "ear-center", "",
+                signalNames[0], signalNames[1], signalNames[2]);
+    const Position ears[2] {earPosition(0), earPosition(1)};
+    for (const auto& trajectory : trajectories) {
+        // the interaural time difference and doppler shifts from the exact delays of each sample
+        double maxAddedITD = 0, maxITDChange = 0, maxInterauralCents = 0, maxEarCenterCents = 0;
+        double prevDelays[3] {}, prevITD = 0;
+        for (std::size_t n = settled; n <= numSamples; ++n) {
+            const Position p = trajectory.position(n / double(sampleRate));
+            const double delays[3] {distance(p, ears[0]) / speedOfSound, distance(p, ears[1]) / speedOfSound, distance(p, {0, 0, 0}) / speedOfSound};
+            const double itd = delays[0] - delays[1];
+            maxAddedITD = std::max(maxAddedITD, std::abs(itd));
+            if (n > settled) {
+                // the doppler shift is the rate the delayed signal is read at, 1 - d(delay)/dt
+                double ratios[3];
+                for (int ch = 0; ch < 3; ++ch)
+                    ratios[ch] = 1 - (delays[ch] - prevDelays[ch]) * sampleRate;
+                maxInterauralCents = std::max(maxInterauralCents, std::abs(1200 * std::log2(ratios[0] / ratios[1])));
+                for (int ch = 0; ch < 2; ++ch)
+                    maxEarCenterCents = std::max(maxEarCenterCents, std::abs(1200 * std::log2(ratios[ch] / ratios[2])));
+                maxITDChange = std::max(maxITDChange, std::abs(itd - prevITD) * sampleRate);
+            }
+            std::copy(delays, delays + 3, prevDelays);
+            prevITD = itd;
+        }
+        std::printf("%-34s %10.1f %10.1f %11.2f %11.2f %12s ", trajectory.name, maxAddedITD * 1e6, maxITDChange * 1e6, maxInterauralCents, maxEarCenterCents, "");
+        // the difference of the inputs the two modes convolve, through the plugin's doppler effect
+        const auto distances = blockDistances(trajectory, numBlocks, blockSize, sampleRate);
+        for (const auto& signal : signals) {
+            const auto outputs = delayedInputs(signal, distances, blockSize, sampleRate, speedOfSound);
+            double levels[2];
+            for (int ch = 0; ch < 2; ++ch) {
+                std::vector<float> difference (numSamples);
+                for (std::size_t n = 0; n < numSamples; ++n)
+                    difference[n] = outputs[2][n] - outputs[ch][n];
+                levels[ch] = 20 * std::log10(std::max(rmsLevel(difference, settled), 1e-20) / std::max(rmsLevel(outputs[ch], settled), 1e-20));
+            }
+            std::printf(" %6.1f/%-6.1f", levels[0], levels[1]);
+        }
+        std::printf("\n");
+    }
+
+    const auto distances = blockDistances(trajectories[0], numBlocks, blockSize, sampleRate);
+    dopplerCost(2, signals[2], distances, blockSize, sampleRate, speedOfSound); // warm up
+    const double perEarCost = dopplerCost(2, signals[2], distances, blockSize, sampleRate, speedOfSound);
+    const double monoCost = dopplerCost(1, signals[2], distances, blockSize, sampleRate, speedOfSound);
+    std::printf("\ndoppler cost per block of a source: per ear %.0f ns, mono %.0f ns (%.2fx)\n", perEarCost, monoCost, perEarCost / monoCost);
+    std::printf("(the per ear mode also convolves each ear's input separately, which the mono mode does once for both)\n");
+    return 0;
+}